@@ -22,22 +22,35 @@ using std::endl;
 
 static Logger loggerMain(log_debug, "loggerMain");
 
-int main() {
-    auto t0_main = CLOCK::now();
-    Logger logger;
-    logger.log("Starting Protocol", log_trace);
-    ////  Keys Server
-    KeysServer keysServer;
-    logger.log(printDuration(t0_main, "KeysServer Initialization"));
-    DataServer dataServer(keysServer);
-
-    ////    (generate data)
-    const std::vector<Client> clients = generateDataClients(keysServer);
-
-    ////    Retrieve Data from Clients
-    std::vector<Point> points = dataServer.retrievePoints_WithThreads(clients);
-
-    int num_of_iterarions = log2(NUMBER_OF_POINTS)-1; //todo can be log (natural logarithm) ?
+/**
+ * @brief the iterations of the protocol over a set of points - until (almost) all of them are in coresets
+ * @param points the points to cluster. consumed - left with the last leftover
+ * @param chunkTag added to the names of the output files (of the chunk, in streaming mode)
+ * @returns the coresets of all the groups of all the iterations (every row is a point and its weight).
+ *  coresets compose - so the ones of disjoint sets of points are merged by concatenation
+ * */
+static std::vector<std::vector<double> >
+runIterations(std::vector<Point> &points,
+              const KeysServer &keysServer,
+              DataServer &dataServer,
+              const std::string &chunkTag = "") {
+    const long numOfPoints = points.size();
+    int num_of_iterarions = std::max(1, int(log2(numOfPoints)) - 1); //todo can be log (natural logarithm) ?
+    std::vector<std::vector<double> > coresetOfPoints;
+
+    //  too few points to pick the reps of all the dims from (see DataServer::pickRandomPoints) -
+    //  they are passed through as they are, each its own coreset (of weight 1)
+    if (numOfPoints < std::pow(1 / EPSILON, DIM)) {
+        for (const DecryptedPoint &decryptedPoint: keysServer.decryptPoints(points)) {
+            std::vector<double> row;
+            row.reserve(DIM + 1);
+            for (const long &coordinate: decryptedPoint) row.emplace_back(double(coordinate) / CONVERSION_FACTOR);
+            row.emplace_back(1);
+            coresetOfPoints.emplace_back(std::move(row));
+        }
+        points.clear();
+        return coresetOfPoints;
+    }
     printNameVal(num_of_iterarions);
 
     for (int i = 0; i < num_of_iterarions; ++i) {
@@ -62,12 +75,7 @@ int main() {
 
         ////  Create points-comparing dict
         ///     - for every 2 points (p1,p2) answers p1[dim]>p2[dim]
-        std::vector<
-                std::unordered_map<
-                        const Point,
-                        std::unordered_map<
-                                const Point,
-                                helib::Ctxt> > >
+        const CmpDict &
                 cmpDict = dataServer.createCmpDict_WithThreads(
                 points,
                 randomPoints
@@ -77,16 +85,16 @@ int main() {
 //        for (short dim = 0; dim < DIM; ++dim) {
 //            cout << "    ======   ";
 //            printNameVal(dim);
-//            for (auto const&[point, map]: cmpDict[dim]) {
-//                printPoint(point, keysServer);
-//                for (auto const&[point2, val]: map) {
-//                    printPoint(point2, keysServer);
-//                    long pVal = keysServer.decryptCtxt(val);
+//            for (const Point &rep: randomPoints[dim]) {
+//                printPoint(rep, keysServer);
+//                for (const Point &point: points) {
+//                    printPoint(point, keysServer);
+//                    long pVal = keysServer.decryptCtxt(cmpDict.isBigger(dim, rep, point));
 //                    printNameVal(pVal);
 //                }
-//                printNameVal(map.size()) << " --- --- ---" << endl;
+//                cout << " --- --- ---" << endl;
 //            }
-//            printNameVal(cmpDict[dim].size()) << " === === ===" << endl;
+//            printNameVal(cmpDict.numOfReps(dim)) << " === === ===" << endl;
 //        }
 //        cout << " --- --- --- --- ---" << endl;
 
@@ -146,7 +154,8 @@ int main() {
                 threshold =
                 dataServer.calculateThreshold(
                         minDistanceTuples,
-                        0);
+                        0,
+                        numOfPoints);
 
         printNameVal(keysServer.decryptNum(threshold));
 
@@ -248,23 +257,26 @@ int main() {
 
 
         /**********   integration to coreset alg    ***********/
-        //  for each mean-group in groups
+        //  for each mean-group in groups - the coresets of the groups are computed in parallel
+        auto t0_coreset = CLOCK::now();     //  for logging, profiling, DBG
+        std::vector<long> coresetMeans;
+        std::vector<std::future<std::vector<std::vector<double> > > > coresets;
         for (auto const &[meanI, points]: groups_by_means) {
+            std::vector<Point> forClean;
+            forClean.reserve(points.size());
+            for (auto const &pair: points) forClean.emplace_back(pair.first);
             std::vector<std::vector<double>> pointsGroup;
             pointsGroup.reserve(points.size());
-            std::vector<Point> forClean;
             // add all non-zero points
-            for (auto const &pair: points) {
-                const Point &currPoint(pair.first);
-                std::vector<long> tempPoint = decryptPoint(currPoint, keysServer);
-                std::vector<double> doublePoint(DIM);
+            for (const DecryptedPoint &decryptedPoint: keysServer.decryptPoints(forClean)) {
+                std::vector<double> doublePoint;
+                doublePoint.reserve(DIM);
                 long checkNull = 0;
-                for (const long &coordinate: decryptPoint(currPoint, keysServer)) {
+                for (const long &coordinate: decryptedPoint) {
                     checkNull += coordinate;
-                    doublePoint.emplace_back(coordinate / CONVERSION_FACTOR);
+                    doublePoint.emplace_back(double(coordinate) / CONVERSION_FACTOR);
                 }
-                if (checkNull) pointsGroup.emplace_back(doublePoint);
-                forClean.emplace_back(currPoint);
+                if (checkNull) pointsGroup.emplace_back(std::move(doublePoint));
             }
             pointsGroup.shrink_to_fit();
             cout << "For Group of Points:\t";
@@ -272,10 +284,12 @@ int main() {
             cout << endl;
             //      call yoni's alg with mean-group
             cout << "Running 1-Mean Coreset Algorithm:" << endl;
-            auto t0_itr_rep = CLOCK::now();     //  for logging, profiling, DBG
-            runCoreset(pointsGroup, pointsGroup.size(), DIM, EPSILON);  // <|-------------
-            loggerMain.log(printDuration(t0_itr_rep, "runCoreset in iteration"));
-
+            coresetMeans.push_back(meanI);
+            coresets.push_back(dataServer.threadPool.submit(
+                    [](const std::vector<std::vector<double> > &group) {
+                        return runCoreset(group, group.size(), DIM, EPSILON);  // <|-------------
+                    },
+                    std::move(pointsGroup)));
         }
 
         // CT for coreset.csv result for multiple iterations
@@ -287,7 +301,15 @@ int main() {
         //    oss.flush();
         oss.clear();
         string filename = IO_DIR + timestamp + "_coreset.csv";
-        string prefix = IO_DIR + timestamp + "_iter_" + to_string(i) + "_";
+        string prefix = IO_DIR + timestamp + chunkTag + "_iter_" + to_string(i) + "_";
+
+        for (int group = 0; group < coresets.size(); ++group) {
+            const std::vector<std::vector<double> > coreset = dataServer.threadPool.wait(coresets[group]);
+            //  every row is a point and its weight
+            toCSV(coreset, coreset.size(), DIM + 1, prefix + to_string(coresetMeans[group]) + "_coreset.csv");
+            coresetOfPoints.insert(coresetOfPoints.end(), coreset.begin(), coreset.end());
+        }
+        loggerMain.log(printDuration(t0_coreset, "runCoreset in iteration"));
 
         cout << "WRITE TO FILES" << endl;
         decAndWriteToFile(points, prefix + POINTS_FILE, keysServer);
@@ -302,8 +324,11 @@ int main() {
             decAndWriteToFile(pointsGroup, prefix + to_string(meanI) + "_" + CHOSEN_FILE, keysServer);
         }
 
+        dataServer.capacityMonitor.printReport();
+
         // prepare for next iteration - clear fields
-        points = leftover;
+        //  (the DataServer's copies of the points of this iteration are recycled by clearForNextIteration)
+        points = std::move(leftover);
         leftover = std::vector<Point>();
 
 //        for (int dim = 0; dim < DIM; ++dim) randomPoints[dim].clear();
@@ -312,8 +337,73 @@ int main() {
 //        leftover.clear();
 //        cmpDict.clear(); //todo - consider not clearing and adding a check in init_dict - if entry exists (from prev iteration) then no need to cmp
 
-                dataServer.clearForNextIteration(points);
+        dataServer.clearForNextIteration(points);
+    }
+
+    return coresetOfPoints;
+}
+
+/**
+ * @param argv the points files uploaded by the clients (see \class{PointFile}).
+ *  with no files - the data is generated (simulated clients).
+ *  if #CHUNK_SIZE is set, the files are streamed - clustered in chunks of #CHUNK_SIZE points
+ *  (the last one takes the tail, if it is too short to be a chunk of its own)
+ * */
+int main(int argc, char *argv[]) {
+    auto t0_main = CLOCK::now();
+    Logger logger;
+    logger.log("Starting Protocol", log_trace);
+    ////  Keys Server
+    KeysServer keysServer;
+    logger.log(printDuration(t0_main, "KeysServer Initialization"));
+    DataServer dataServer(keysServer);
+
+    std::vector<std::vector<double> > coreset;
+    if (1 < argc && 0 < CHUNK_SIZE) {
+        ////    Streaming - read, cluster and forget a chunk at a time, so the memory is bounded by #CHUNK_SIZE
+        //  a chunk runs only once the next one has the points of its reps (m^DIM - see pickRandomPoints),
+        //  so a short tail is merged into the last chunk instead of run on its own
+        const long minChunkSize = std::pow(1 / EPSILON, DIM);
+        std::vector<Point> chunk;
+        chunk.reserve(CHUNK_SIZE + minChunkSize);
+        long chunkNumber = 0;
+        auto runChunk = [&]() {
+            auto t0_chunk = CLOCK::now();
+            //  the stages read the points of the DataServer (see retrievedPoints) - the chunk is its points now
+            dataServer.clearForNextIteration(chunk);
+            std::vector<std::vector<double> > coresetOfChunk =
+                    runIterations(chunk, keysServer, dataServer, "_chunk_" + to_string(chunkNumber));
+            coreset.insert(coreset.end(), coresetOfChunk.begin(), coresetOfChunk.end());
+            chunk.clear();
+            dataServer.clearForNextChunk();
+            loggerMain.log(printDuration(t0_chunk, "chunk " + to_string(chunkNumber++)));
+        };
+        for (int file = 1; file < argc; ++file)
+            PointFile::read(argv[file], keysServer.getPublicKey(), [&](Point &&point) {
+                chunk.push_back(std::move(point));
+                if (CHUNK_SIZE + minChunkSize == chunk.size()) {
+                    std::vector<Point> next(std::make_move_iterator(chunk.begin() + CHUNK_SIZE),
+                                            std::make_move_iterator(chunk.end()));
+                    chunk.erase(chunk.begin() + CHUNK_SIZE, chunk.end());
+                    runChunk();
+                    chunk = std::move(next);
+                }
+            });
+        if (!chunk.empty()) runChunk();
+    } else {
+        ////    Retrieve Data from Clients
+        std::vector<Point> points;
+        if (1 < argc)
+            points = dataServer.retrievePoints_FromFiles(std::vector<std::string>(argv + 1, argv + argc));
+        else {
+            ////    (generate data)
+            const std::vector<Client> clients = generateDataClients(keysServer);
+            points = dataServer.retrievePoints_WithThreads(clients);
+        }
+        coreset = runIterations(points, keysServer, dataServer);
     }
+    //  the coreset of all the points - of all the chunks and iterations
+    toCSV(coreset, coreset.size(), DIM + 1, IO_DIR + "coreset.csv");
     //-----------------------------------------------------------
 
     logger.log(printDuration(t0_main, "Main"));
@@ -352,28 +442,23 @@ int main_without_threads() {
 
     ////  Create points-comparing dict
     ///     - for every 2 points (p1,p2) answers p1[dim]>p2[dim]
-    const std::vector<
-            std::unordered_map<
-                    const Point,
-                    std::unordered_map<
-                            const Point,
-                            helib::Ctxt> > >
+    const CmpDict
             cmpDict = dataServer.createCmpDict(points, randomPoints);
 
     cout << " ---   The Dictionary  ---" << endl;
     for (short dim = 0; dim < DIM; ++dim) {
         cout << "    ======   ";
         printNameVal(dim);
-        for (auto const&[point, map]: cmpDict[dim]) {
-            printPoint(point, keysServer);
-            for (auto const&[point2, val]: map) {
-                printPoint(point2, keysServer);
-                long pVal = keysServer.decryptCtxt(val);
+        for (const Point &rep: randomPoints[dim]) {
+            printPoint(rep, keysServer);
+            for (const Point &point: points) {
+                printPoint(point, keysServer);
+                long pVal = keysServer.decryptCtxt(cmpDict.isBigger(dim, rep, point));
                 printNameVal(pVal);
             }
-            printNameVal(map.size()) << " --- --- ---" << endl;
+            cout << " --- --- ---" << endl;
         }
-        printNameVal(cmpDict[dim].size()) << " === === ===" << endl;
+        printNameVal(cmpDict.numOfReps(dim)) << " === === ===" << endl;
     }
     cout << " --- --- --- --- ---" << endl;
 
@@ -29,6 +29,7 @@ static json jsonConfig = json::parse(config_json_file);
  * */
 static const short NUMBER_OF_THREADS = jsonConfig["data_properties"]["number_of_threads"];
 static const short NUMBER_OF_POINTS = jsonConfig["data_properties"]["number_of_points"];
+static const long CHUNK_SIZE = jsonConfig["data_properties"]["chunk_size"];
 //static const short NUMBER_OF_CLIENTS = NUMBER_OF_POINTS / NUMBER_OF_THREADS;
 static const short NUMBER_OF_CLIENTS = jsonConfig["data_properties"]["number_of_clients"];
 static const short DIM = jsonConfig["data_properties"]["DIM"];
@@ -37,7 +38,6 @@ static const short OUT_SIZE = 2 * BIT_SIZE;
 static const short NUMBERS_RANGE = pow(2, BIT_SIZE) - 1; // pow(2, BIT_SIZE)-0
 static const short DISTANCE_BIT_SIZE =
         std::log2(NUMBER_OF_POINTS * (NUMBERS_RANGE * NUMBERS_RANGE)); //fixme make sure
-static const short CID_BIT_SIZE = NUMBER_OF_POINTS; //fixme make sure
 static const short range_lim = jsonConfig["data_properties"]["range_lim"];
 static const std::string range_lim_comment = jsonConfig["data_properties"]["range_lim_comment"];
 static const short low_limit = jsonConfig["data_properties"]["low_limit"];
@@ -46,6 +46,14 @@ static const short decimal_digits = jsonConfig["data_properties"]["decimal_digit
 static const short CONVERSION_FACTOR = pow(10, decimal_digits);
 static const std::string conversion_factor_comment = jsonConfig["data_properties"]["conversion_factor_comment"];
 static const double EPSILON = jsonConfig["data_properties"]["epsilon"];
+//  the eps-net has at most (1 + m^(dim+1)) slices per dim, where m = 1/EPSILON - and one mean per slice
+static const long NUMBER_OF_MEANS = [] {
+    long numOfMeans = 1;
+    for (short dim = 0; dim < DIM; ++dim) numOfMeans *= 1 + long(std::pow(1 / EPSILON, dim + 1));
+    return numOfMeans;
+}();
+//  a cid is the index of a mean (see Point::setCid), so log2(NUMBER_OF_MEANS) bits are enough
+static const short CID_BIT_SIZE = std::max(1L, long(std::ceil(std::log2(NUMBER_OF_MEANS))));
 
 
 /*
@@ -53,15 +61,20 @@ static const double EPSILON = jsonConfig["data_properties"]["epsilon"];
  * */
 [[maybe_unused]] static const bool DBG = jsonConfig["flags"]["DBG"];
 [[maybe_unused]] static const bool VERBOSE = jsonConfig["flags"]["VERBOSE"];
+static const std::string KEYS_SERVER_CHANNEL = jsonConfig["flags"]["keys_server_channel"];
 //// in productopn sould be `#define`d and not `statc const..`
 //#define VERBOSE true
 //#define DBG true //#define DBG false
 [[maybe_unused]] static const bool helib_bootstrap = jsonConfig["helib_flags"]["helib_bootstrap"];
+static const std::string DISTANCE_KERNEL = jsonConfig["helib_flags"]["distance_kernel"];
+static const double MIN_SECURITY_LEVEL = jsonConfig["helib_flags"]["min_security_level"];
+static const double RECRYPT_CAPACITY_THRESHOLD = jsonConfig["helib_flags"]["recrypt_capacity_threshold"];
 
 /*
  * Data-Files Names
  * */
 static const std::string IO_DIR = jsonConfig["files"]["io_dir"]; // todo USE
+static const std::string KEYS_DIR = jsonConfig["files"]["keys_dir"];
 static const std::string POINTS_FILE = jsonConfig["files"]["points_file"];
 static const std::string POINTS_COPY_FILE = jsonConfig["files"]["points_copy_file"];
 static const std::string RANDS_FILE = jsonConfig["files"]["rands_file"];
@@ -0,0 +1,111 @@
+#include "CapacityMonitor.h"
+
+static Logger loggerCapacityMonitor(log_debug, "loggerCapacityMonitor");
+
+CapacityMonitor::CapacityMonitor(const helib::PubKey &public_key, double threshold, long batchSize) :
+        canRecrypt(public_key.isBootstrappable()),
+        threshold(threshold),
+        batchSize(batchSize),
+        freshCapacity(calculateFreshCapacity(public_key)),
+        capacityIn(freshCapacity) {}
+
+double CapacityMonitor::calculateFreshCapacity(const helib::PubKey &public_key) {
+    Ctxt fresh(public_key);
+    public_key.Encrypt(fresh, NTL::ZZX(0L));
+    return fresh.capacity();
+}
+
+double CapacityMonitor::minCapacity(const std::vector<Ctxt *> &ctxts) const {
+    double capacity = freshCapacity;
+    for (const Ctxt *ctxt: ctxts)
+        if (!ctxt->isEmpty()) capacity = std::min(capacity, ctxt->capacity());
+    return capacity;
+}
+
+void CapacityMonitor::recryptBatch(const std::vector<Ctxt *> &ctxts, long first, long last) {
+    for (long i = first; i < last; ++i) ctxts[i]->getPubKey().reCrypt(*ctxts[i]);
+}
+
+long CapacityMonitor::checkpoint(const std::string &stage, const std::vector<Ctxt *> &ctxts, ThreadPool &threadPool) {
+    auto t0_checkpoint = CLOCK::now();
+
+    StageReport report{stage, long(ctxts.size()), capacityIn, minCapacity(ctxts), 0, 0};
+
+    //  only the ones that would not survive the next stage
+    const double threshold = thresholdOf(stage);
+    std::vector<Ctxt *> toRecrypt;
+    if (canRecrypt || refresher)
+        for (Ctxt *ctxt: ctxts)
+            if (!ctxt->isEmpty() && ctxt->capacity() < threshold) toRecrypt.push_back(ctxt);
+
+    if (canRecrypt) {
+        std::vector<std::future<void> > futures;
+        for (long first = 0; first < toRecrypt.size(); first += batchSize)
+            futures.push_back(threadPool.submit(&CapacityMonitor::recryptBatch,
+                                                std::cref(toRecrypt),
+                                                first,
+                                                std::min(first + batchSize, long(toRecrypt.size()))));
+        threadPool.wait(futures);
+    } else if (!toRecrypt.empty()) {
+        //  the batches are sent all at once, and the keys server refreshes them while the replies are collected
+        std::vector<std::future<std::vector<Ctxt> > > futures;
+        for (long first = 0; first < toRecrypt.size(); first += batchSize) {
+            std::vector<Ctxt> batch;
+            for (long i = first; i < std::min(first + batchSize, long(toRecrypt.size())); ++i)
+                batch.push_back(*toRecrypt[i]);
+            futures.push_back(refresher(batch));
+        }
+        for (long b = 0; b < futures.size(); ++b) {
+            std::vector<Ctxt> refreshed = threadPool.wait(futures[b]);
+            for (long i = 0; i < refreshed.size(); ++i) *toRecrypt[b * batchSize + i] = std::move(refreshed[i]);
+        }
+    }
+
+    report.recrypted = toRecrypt.size();
+    report.capacityAfter = toRecrypt.empty() ? report.capacityOut : minCapacity(ctxts);
+    capacityIn = report.capacityAfter;
+    reports.push_back(report);
+
+    if (!canRecrypt && !refresher && report.capacityOut < threshold)
+        loggerCapacityMonitor.log("checkpoint '" + stage + "' is below the threshold ("
+                                  + std::to_string(report.capacityOut) + " < " + std::to_string(threshold)
+                                  + " bits), the keys are not bootstrappable and there is no refresher");
+    loggerCapacityMonitor.log(printDuration(
+            t0_checkpoint,
+            "checkpoint '" + stage + "' (" + std::to_string(report.recrypted) + " recrypted)"));
+
+    return report.recrypted;
+}
+
+void CapacityMonitor::setStageDepths(const std::vector<std::pair<std::string, long> > &stageDepths) {
+    stageThresholds.clear();
+    for (long stage = 0; stage < stageDepths.size(); ++stage) {
+        const long nextDepth = stageDepths[(stage + 1) % stageDepths.size()].second;
+        stageThresholds[stageDepths[stage].first] = double(nextDepth * KeysServer::BITS_PER_LEVEL);
+    }
+}
+
+double CapacityMonitor::thresholdOf(const std::string &stage) const {
+    auto planned = stageThresholds.find(stage);
+    return stageThresholds.end() == planned ? threshold : planned->second;
+}
+
+void CapacityMonitor::printReport() const {
+    cout << " ---   Capacity (bits) per Stage  ---" << endl;
+    for (const StageReport &report: reports)
+        cout << "   " << report.stage << ": "
+             << report.capacityIn << " -> " << report.capacityOut
+             << " (consumed " << report.consumed() << ", over " << report.numOfCtxts << " ciphertexts)"
+             << ", recrypted " << report.recrypted
+             << " -> " << report.capacityAfter << endl;
+    cout << " --- --- --- --- ---" << endl;
+}
+
+void CapacityMonitor::addCtxts(std::vector<Ctxt *> &ctxts, EncryptedNum &num) {
+    for (Ctxt &bit: num) ctxts.push_back(&bit);
+}
+
+void CapacityMonitor::addCtxts(std::vector<Ctxt *> &ctxts, Point &point) {
+    for (EncryptedNum &coordinate: point.cCoordinates) addCtxts(ctxts, coordinate);
+    addCtxts(ctxts, point.cid);
+}
@@ -0,0 +1,119 @@
+#ifndef ENCRYPTEDKMEANS_CAPACITYMONITOR_H
+#define ENCRYPTEDKMEANS_CAPACITYMONITOR_H
+
+#include <functional>
+#include <future>
+#include <unordered_map>
+
+#include "Point.h"
+#include "utils/ThreadPool.h"
+
+/**
+ * @class CapacityMonitor
+ * @brief Tracks the noise budget (\fn{Ctxt::capacity}, in bits) of the ciphertexts along the pipeline,
+ *  and schedules the bootstrapping.
+ * At every stage boundary (see \fn{checkpoint}) the output ciphertexts of the stage are measured -
+ *  what the stage consumed is reported, and only the ciphertexts that are below the threshold are recrypted,
+ *  in parallel batches. So bootstrapping is paid only where it is needed (and never when the keys can't recrypt).
+ * If the keys are not bootstrappable, the ciphertexts below the threshold are refreshed by the keys server instead
+ *  (decrypted and encrypted again - see \fn{setRefresher}), if it is given.
+ * The threshold of a checkpoint is the capacity that the stage after it consumes, if the depths of the stages
+ *  are known (see \fn{setStageDepths}) - and the fixed one otherwise.
+ * */
+class CapacityMonitor {
+public:
+    struct StageReport {
+        std::string stage;
+        long numOfCtxts;
+        double capacityIn;      //  the lowest capacity after the previous checkpoint (fresh, for the first one)
+        double capacityOut;     //  the lowest capacity of the output of the stage
+        long recrypted;         //  how many ciphertexts were recrypted (or refreshed) after the stage
+        double capacityAfter;   //  the lowest capacity after the recryption
+
+        double consumed() const {
+            return capacityIn - capacityOut;
+        }
+    };
+
+    /**
+     * @param public_key the key of all the ciphertexts. recryption is possible only if it is bootstrappable
+     * @param threshold recrypt ciphertexts whose capacity is below it (bits) - at the checkpoints with no planned depth
+     * @param batchSize the number of ciphertexts recrypted by each task
+     * */
+    explicit CapacityMonitor(const helib::PubKey &public_key,
+                             double threshold = RECRYPT_CAPACITY_THRESHOLD,
+                             long batchSize = 32);
+
+    /**
+     * @brief a stage boundary: measure the output of the stage, recrypt the ciphertexts that need it, and report
+     * @param stage the name of the stage (for the report)
+     * @param ctxts the output of the stage. empty (zero) ciphertexts are ignored
+     * @returns the number of recrypted ciphertexts
+     * */
+    long checkpoint(const std::string &stage, const std::vector<Ctxt *> &ctxts, ThreadPool &threadPool);
+
+    /**
+     * @brief the threshold of each checkpoint from the planned depths of the pipeline (\var{KeysServer::FheParams}):
+     *  the output of a stage must survive the next one, so it is the depth of the next stage
+     *  (the first one, for the last - the next iteration) times \var{KeysServer::BITS_PER_LEVEL}
+     * @param stageDepths the depth of every stage, in the order of the pipeline. a stage is its checkpoint's name
+     * */
+    void setStageDepths(const std::vector<std::pair<std::string, long> > &stageDepths);
+
+    //! the threshold of the checkpoint of a stage (bits)
+    double thresholdOf(const std::string &stage) const;
+
+    //! sends a batch of ciphertexts to be refreshed - e.g. \fn{KeysServerChannel::refresh}
+    using Refresher = std::function<std::future<std::vector<Ctxt> >(const std::vector<Ctxt> &)>;
+
+    /**
+     * @brief w/o bootstrapping - refresh the ciphertexts that need it by this (a request per batch), at every checkpoint
+     * */
+    void setRefresher(Refresher refresher) {
+        this->refresher = std::move(refresher);
+    }
+
+    const std::vector<StageReport> &getReports() const {
+        return reports;
+    }
+
+    /**
+     * @brief print the reports of the checkpoints since the last \fn{clearReports} (i.e. of the current iteration)
+     * */
+    void printReport() const;
+
+    /**
+     * @brief start the reports of a new iteration (the capacity is tracked on - it is not reset)
+     * */
+    void clearReports() {
+        reports.clear();
+    }
+
+    /**
+     * @brief the lowest capacity of non-empty ciphertexts (the capacity of a fresh one, if there are none)
+     * */
+    double minCapacity(const std::vector<Ctxt *> &ctxts) const;
+
+    /*  collect the ciphertexts of the stage outputs    */
+    static void addCtxts(std::vector<Ctxt *> &ctxts, EncryptedNum &num);
+
+    static void addCtxts(std::vector<Ctxt *> &ctxts, Point &point);
+
+private:
+    const bool canRecrypt;
+    const double threshold;
+    //! [stage] - the thresholds planned by \fn{setStageDepths}
+    std::unordered_map<std::string, double> stageThresholds;
+    const long batchSize;
+    Refresher refresher;
+    const double freshCapacity;
+    double capacityIn;
+    std::vector<StageReport> reports;
+
+    static double calculateFreshCapacity(const helib::PubKey &public_key);
+
+    static void recryptBatch(const std::vector<Ctxt *> &ctxts, long first, long last);
+};
+
+
+#endif //ENCRYPTEDKMEANS_CAPACITYMONITOR_H
@@ -41,6 +41,34 @@ Client &Client::addEncryptedPoint(Point &point) {
     return *this;
 }
 
+const std::vector<Point> &
+Client::encryptPoints(const std::vector<DecryptedPoint> &coordinates, ThreadPool &threadPool) {
+    auto t0_encryptPoints = CLOCK::now();     //  for logging, profiling, DBG
+
+    //  the (not yet encrypted) points are created here, in order - so the ids follow the order of the coordinates
+    const unsigned long first = points.size();
+    points.reserve(first + coordinates.size());
+    for (const DecryptedPoint &pPoint: coordinates) {
+        points.emplace_back(public_key);
+        points.back().pCoordinatesDBG = pPoint;
+        points.back().isEmptyDBG = false;
+    }
+
+    std::vector<std::future<void> > futures;
+    futures.reserve(coordinates.size() * DIM);
+    for (unsigned long i = 0; i < coordinates.size(); ++i)
+        for (short dim = 0; dim < DIM; ++dim)
+            futures.push_back(threadPool.submit([this, &coordinates, first, i, dim]() {
+                EncryptedNum &cNum = points[first + i].cCoordinates[dim];
+                for (long bit = 0; bit < cNum.size(); ++bit)
+                    public_key.Encrypt(cNum[bit], NTL::to_ZZX((coordinates[i][dim] >> bit) & 1));
+            }));
+    threadPool.wait(futures);
+
+    loggerClient.log(printDuration(t0_encryptPoints, "encryptPoints"));
+    return points;
+}
+
 std::vector<long> Client::decryptCoordinate(int i) {
     cout << "Client::decryptCoordinate" << endl;
     loggerClient.log("decryptCoordiantes", log_debug);
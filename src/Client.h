@@ -5,6 +5,8 @@
 #include <utils/aux.h>
 
 #include "Point.h"
+#include "PointFile.h"
+#include "utils/ThreadPool.h"
 
 /**
  * @class Client
@@ -46,6 +48,14 @@ public:
 
     Client &addEncryptedPoint(Point &point);
 
+    /**
+     * @brief encrypt a list of points at once - a task per (point, dim) on the given pool.
+     * @note every bit gets a fresh encryption: reusing a ciphertext of 0/1 would show the DataServer
+     *  which bits are equal. the cid bits are already trivial (public) ciphertexts (see Point::setCid)
+     * @returns the client's points (including previously encrypted ones)
+     * */
+    const std::vector<Point> &encryptPoints(const std::vector<DecryptedPoint> &coordinates, ThreadPool &threadPool);
+
     /**
      *
      * */
@@ -60,6 +70,13 @@ public:
         return points;
     }
 
+    /**
+     * @brief upload the client's points - write them as a \class{PointFile}
+     * */
+    void writePoints(const std::string &filename) const {
+        PointFile::write(points, filename);
+    }
+
 
     const helib::PubKey &getPublicKey() const{
         return (helib::PubKey &) encryptionKey;
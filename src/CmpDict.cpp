@@ -0,0 +1,104 @@
+
+#include "CmpDict.h"
+
+void CmpDict::init(const std::vector<std::vector<Point> > &randomPoints,
+                   const std::vector<Point> &points,
+                   const Point &tinyRandomPoint) {
+    clear();
+
+    columns.reserve(points.size() + 1);
+    columnIndex.reserve(points.size() + 1);
+    for (const Point &point: points) {
+        columnIndex.emplace(point.id, columns.size());
+        columns.push_back(&point);
+    }
+    if (columnIndex.emplace(tinyRandomPoint.id, columns.size()).second)
+        columns.push_back(&tinyRandomPoint);
+    //  the reps are sorted copies (with new ids) - compared as points too, by the reps of the other dims
+    for (const std::vector<Point> &repsOfDim: randomPoints)
+        for (const Point &rep: repsOfDim)
+            if (columnIndex.emplace(rep.id, columns.size()).second)
+                columns.push_back(&rep);
+
+    reps.resize(DIM);
+    repIndex.resize(DIM);
+    entries.resize(DIM);
+    cache.resize(DIM);
+    for (short dim = 0; dim < DIM; ++dim) {
+        for (const Point &rep: randomPoints[dim]) {
+            repIndex[dim].emplace(rep.id, reps[dim].size());
+            reps[dim].push_back(&rep);
+            cache[dim][rep.id].reserve(columns.size());
+        }
+        entries[dim].assign(reps[dim].size(), std::vector<const Entry *>(columns.size(), nullptr));
+    }
+}
+
+long CmpDict::compareRep(short dim, long repIndex) {
+    const Point &rep = *reps[dim][repIndex];
+    std::unordered_map<long, Entry> &row = cache[dim].at(rep.id);
+    long computed = 0;
+    for (unsigned long column = 0; column < columns.size(); ++column) {
+        const Point &point = *columns[column];
+        //  a pair of reps of this dim is compared once - by the row of the first one (see \fn{mirrorRepPairs})
+        auto otherRep = this->repIndex[dim].find(point.id);
+        if (this->repIndex[dim].end() != otherRep && otherRep->second < repIndex) continue;
+        std::vector<CBit> res = rep.isBiggerThan(point, dim);
+        entries[dim][repIndex][column] = &(row.emplace(point.id, Entry(res[0], res[1])).first->second);
+        ++computed;
+    }
+    return computed;
+}
+
+long CmpDict::mirrorRepPairs() {
+    long mirrored = 0;
+    for (short dim = 0; dim < DIM; ++dim)
+        for (long second = 0; second < reps[dim].size(); ++second) {
+            std::unordered_map<long, Entry> &row = cache[dim].at(reps[dim][second]->id);
+            for (long first = 0; first < second; ++first) {
+                const long column = columnIndex.at(reps[dim][first]->id);
+                //  (first > second, second > first) in the row of the first is (second > first, first > second) here
+                const Entry &entry = *entries[dim][first][columnIndex.at(reps[dim][second]->id)];
+                entries[dim][second][column] =
+                        &(row.emplace(reps[dim][first]->id, Entry(entry.second, entry.first)).first->second);
+                ++mirrored;
+            }
+        }
+    return mirrored;
+}
+
+const CBit &CmpDict::isBigger(short dim, long a, long b) const {
+    auto rep = repIndex[dim].find(a);
+    if (repIndex[dim].end() != rep) return entries[dim][rep->second][columnIndex.at(b)]->first;
+    return entries[dim][repIndex[dim].at(b)][columnIndex.at(a)]->second;
+}
+
+long CmpDict::numOfCached() const {
+    long cached = 0;
+    for (auto const &rows: cache)
+        for (auto const &[repId, row]: rows) cached += row.size();
+    return cached;
+}
+
+void CmpDict::clear() {
+    reps.clear();
+    repIndex.clear();
+    columns.clear();
+    columnIndex.clear();
+    entries.clear();
+    cache.clear();
+}
+
+void CmpDict::collectCtxts(std::vector<Ctxt *> &ctxts) {
+    //  the view points into the stored comparisons, which are owned (and mutable) here
+    for (short dim = 0; dim < entries.size(); ++dim)
+        for (long rep = 0; rep < entries[dim].size(); ++rep) {
+            std::unordered_map<long, Entry> &row = cache[dim].at(reps[dim][rep]->id);
+            for (const Point *point: columns) {
+                auto cached = row.find(point->id);
+                if (row.end() == cached) continue;
+                ctxts.push_back(&(cached->second.first));
+                ctxts.push_back(&(cached->second.second));
+            }
+        }
+}
@@ -0,0 +1,105 @@
+
+#ifndef ENCRYPTEDKMEANS_CMPDICT_H
+#define ENCRYPTEDKMEANS_CMPDICT_H
+
+#include "Point.h"
+
+/**
+ * @class CmpDict
+ * @brief The comparison dictionary: for every rep R of dim and every point p, the answers to
+ *  R[dim] > p[dim] and p[dim] > R[dim].
+ * Keyed by point id - rows are the reps of each dimension, columns are all the points (and the tiny point).
+ * The current view is dense and allocated up front (by \fn{init}),
+ *  so every (dim, rep) row can be filled by a different thread with no locks,
+ *  and a lookup is two index lookups instead of hashing (and copying) whole points.
+ * The comparisons themselves are owned by a per-row store that the view points into, and live for one iteration:
+ *  the reps are sorted copies with fresh ids (see \fn{Point::sortByDim}), so no (rep, point) pair comes back
+ *  in the next one - everything is dropped by \fn{clear}.
+ * */
+class CmpDict {
+public:
+    /**
+     * @brief allocate the current view. must be called before any \fn{compareRep}.
+     * @param randomPoints - the reps: a vector of size #DIM, each node is a vector of the reps of that dim
+     * @param points - all the points (in current group)
+     * @param tinyRandomPoint - the rep of the null points. it is also compared as a point.
+     * @note the reps are columns too (unless they already are - by id).
+     * @note the points and the reps are not copied, so they must outlive the \fn{compareRep} calls.
+     * */
+    void init(const std::vector<std::vector<Point> > &randomPoints,
+              const std::vector<Point> &points,
+              const Point &tinyRandomPoint);
+
+    /**
+     * @brief compare one rep with all the points, and fill its row.
+     *  the reps are columns too, so a pair of reps of the same dim would be compared by both of their rows -
+     *  it is compared only by the row of the first one, and shared with the other by \fn{mirrorRepPairs}.
+     * @note rows are independent, so different rows may be filled concurrently.
+     * @returns the number of comparisons actually computed
+     * */
+    long compareRep(short dim, long repIndex);
+
+    /**
+     * @brief fill the rep pairs that \fn{compareRep} left to the row of the other rep - (a > b, b > a) of one row
+     *  is (b > a, a > b) of the other, so no comparison is made. must be called after all the rows are filled.
+     * @returns the number of mirrored pairs
+     * */
+    long mirrorRepPairs();
+
+    long numOfReps(short dim) const {
+        return reps[dim].size();
+    }
+
+    long numOfColumns() const {
+        return columns.size();
+    }
+
+    /**
+     * @brief the answer to a[dim] > b[dim]. at least one of a, b must be a rep of dim.
+     * (if they are the same point the answer is true)
+     * @return const CBit &
+     * */
+    const CBit &isBigger(short dim, const Point &a, const Point &b) const {
+        return isBigger(dim, a.id, b.id);
+    }
+
+    const CBit &isBigger(short dim, long a, long b) const;
+
+    bool empty() const {
+        return columns.empty();
+    }
+
+    //! the number of stored comparisons (of pairs) of all the dims
+    long numOfCached() const;
+
+    /**
+     * @brief collect the ciphertexts of the current view (e.g. for a \class{CapacityMonitor} checkpoint)
+     * */
+    void collectCtxts(std::vector<Ctxt *> &ctxts);
+
+    /**
+     * @brief clear the current view, and the comparisons
+     * */
+    void clear();
+
+private:
+    using Entry = std::pair<CBit, CBit>;    //  rep > point, point > rep
+
+    //! [dim] - the reps of each dim, and the row of each rep id
+    std::vector<std::vector<const Point *> > reps;
+    std::vector<std::unordered_map<long, long> > repIndex;
+
+    //! all the points (and the tiny point), and the column of each point id
+    std::vector<const Point *> columns;
+    std::unordered_map<long, long> columnIndex;
+
+    //! [dim][rep][column] - the current view, pointing into the comparisons
+    std::vector<std::vector<std::vector<const Entry *> > > entries;
+
+    //! [dim][rep id][point id] - the comparisons of the current iteration
+    //! (the rows of the current reps are created by \fn{init}, so \fn{compareRep} never inserts into the outer map)
+    std::vector<std::unordered_map<long, std::unordered_map<long, Entry> > > cache;
+};
+
+
+#endif //ENCRYPTEDKMEANS_CMPDICT_H
@@ -0,0 +1,63 @@
+#include "CtxtPool.h"
+
+EncryptedNum CtxtPool::copyOf(const EncryptedNum &num) {
+    EncryptedNum copy;
+    {
+        std::lock_guard<std::mutex> lock(freeLock);
+        auto sameSize = free.find(num.size());
+        if (free.end() != sameSize && !sameSize->second.empty()) {
+            copy = std::move(sameSize->second.back());
+            sameSize->second.pop_back();
+            kept -= copy.size();
+        }
+    }
+
+    if (copy.empty()) {
+        allocated += num.size();
+        return num;
+    }
+    //  the assignment keeps the storage of the recycled parts (when the shapes match)
+    for (long bit = 0; bit < num.size(); ++bit) copy[bit] = num[bit];
+    reused += num.size();
+    return copy;
+}
+
+void CtxtPool::recycle(EncryptedNum &num) {
+    EncryptedNum released;
+    {
+        std::lock_guard<std::mutex> lock(freeLock);
+        if (!num.empty() && kept + long(num.size()) <= capacity) {
+            kept += num.size();
+            free[num.size()].push_back(std::move(num));
+        } else released.swap(num);
+    }
+    num.clear();    //  (moved-from) - and what was not kept is released here, out of the lock
+}
+
+void CtxtPool::recycle(std::vector<EncryptedNum> &nums) {
+    for (EncryptedNum &num: nums) recycle(num);
+    nums.clear();
+}
+
+void CtxtPool::clear() {
+    std::unordered_map<long, std::vector<EncryptedNum> > released;
+    {
+        std::lock_guard<std::mutex> lock(freeLock);
+        released.swap(free);
+        kept = 0;
+    }
+}
+
+void CtxtPool::setCapacity(long capacity) {
+    std::vector<EncryptedNum> released;
+    {
+        std::lock_guard<std::mutex> lock(freeLock);
+        this->capacity = capacity;
+        for (auto &[bits, nums]: free)
+            while (kept > capacity && !nums.empty()) {
+                kept -= nums.back().size();
+                released.push_back(std::move(nums.back()));
+                nums.pop_back();
+            }
+    }
+}
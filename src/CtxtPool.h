@@ -0,0 +1,82 @@
+#ifndef ENCRYPTEDKMEANS_CTXTPOOL_H
+#define ENCRYPTEDKMEANS_CTXTPOOL_H
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+#include "utils/aux.h"
+
+/**
+ * @class CtxtPool
+ * @brief A free list of ciphertexts that are done with, to be reused instead of allocated again.
+ * The parts of a helib::Ctxt (its DoubleCRTs) are allocated by NTL, so they can't be placed in an arena of our own -
+ *  but assigning a ciphertext into a recycled one of the same shape reuses the storage of its parts.
+ * So the encrypted numbers of a retired point batch (e.g. the points of the previous iteration, see
+ *  \fn{DataServer::clearForNextIteration}) are kept here whole - each one a contiguous block of ciphertexts,
+ *  by its number of bits - and the copies of the next batch are built in them
+ *  (see \fn{Point::Point(const Point &, CtxtPool &)}).
+ * @note thread safe. the numbers are moved in and out as a whole (the ciphertexts themselves are never moved).
+ * */
+class CtxtPool {
+public:
+    /**
+     * @param capacity at most this many ciphertexts are kept - the rest are released
+     * */
+    explicit CtxtPool(long capacity = 0) : capacity(capacity) {}
+
+    CtxtPool(const CtxtPool &) = delete;
+
+    CtxtPool &operator=(const CtxtPool &) = delete;
+
+    /**
+     * @brief a copy of an encrypted number, built in a recycled one of the same size (a new one if there is none)
+     * @return EncryptedNum
+     * */
+    EncryptedNum copyOf(const EncryptedNum &num);
+
+    /**
+     * @brief take back a number that is no longer used (released, if the pool is full). it is left empty.
+     * */
+    void recycle(EncryptedNum &num);
+
+    void recycle(std::vector<EncryptedNum> &nums);
+
+    /**
+     * @brief release all the kept ciphertexts
+     * */
+    void clear();
+
+    /**
+     * @brief keep at most this many ciphertexts from now on (the ones over it are released).
+     *  e.g. only as many as the copies of the next iteration will take, so the pool is bounded by the working set
+     * */
+    void setCapacity(long capacity);
+
+    //! the number of kept ciphertexts
+    long size() const {
+        std::lock_guard<std::mutex> lock(freeLock);
+        return kept;
+    }
+
+    //! the number of ciphertexts that were copied into recycled ones / had to be allocated
+    long reusedCount() const {
+        return reused;
+    }
+
+    long allocatedCount() const {
+        return allocated;
+    }
+
+private:
+    long capacity;
+    //! [number of bits] - the kept numbers of that size
+    std::unordered_map<long, std::vector<EncryptedNum> > free;
+    long kept = 0;
+    mutable std::mutex freeLock;
+    std::atomic<long> reused{0};
+    std::atomic<long> allocated{0};
+};
+
+
+#endif //ENCRYPTEDKMEANS_CTXTPOOL_H
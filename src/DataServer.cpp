@@ -27,7 +27,7 @@ DataServer::retrievePoints(
     points.reserve(pow(clients.size(), 2) / 2); // preallocate memory
     for (const Client &c: clients)
         for (const Point &p: c.getPoints())
-            points.emplace_back(Point(p));
+            points.emplace_back(p);
     //            points.insert(points.end(),c.getPoints().begin(), c.getPoints().end());
     points.shrink_to_fit();
 
@@ -47,7 +47,7 @@ DataServer::retrievePoints_Thread(
     for (const Client &c: clients)
         for (const Point &p: c.getPoints()) {
             retrievedPointsLock.lock();
-            retrievedPoints.emplace_back(Point(p));
+            retrievedPoints.emplace_back(p);
             retrievedPointsLock.unlock();
         }
     //            points.insert(points.end(),c.getPoints().begin(), c.getPoints().end());
@@ -65,16 +65,16 @@ DataServer::retrievePoints_WithThreads(
 //    if (clients.empty()) return;
 
     unsigned long splitSize = clients.size() / numOfThreads;
-    std::vector<Client> splits[numOfThreads];
-    std::vector<std::thread> threadVec;
+    std::vector<std::vector<Client> > splits(numOfThreads);
+    std::vector<std::future<void> > futures;
     for (int i = 0; i < numOfThreads; ++i) {
         splits[i] = (i == numOfThreads - 1) ?
                     std::vector<Client>(clients.begin() + i * splitSize, clients.end()) :
                     std::vector<Client>(clients.begin() + i * splitSize,
                                         clients.begin() + (i + 1) * splitSize);
-        threadVec.emplace_back(&DataServer::retrievePoints_Thread, this, splits[i]);
+        futures.push_back(threadPool.submit(&DataServer::retrievePoints_Thread, this, std::cref(splits[i])));
     }
-    for (auto &t: threadVec) t.join();
+    threadPool.wait(futures);
 
     loggerDataServer.log(
             printDuration(t0_retrievePoints, "retrievePoints_WithThreads"));
@@ -83,6 +83,31 @@ DataServer::retrievePoints_WithThreads(
 }
 
 
+void
+DataServer::retrievePoints_File_Thread(const std::string &filename) {
+    PointFile::read(filename, keysServer.getPublicKey(), [this](Point &&point) {
+        retrievedPointsLock.lock();
+        retrievedPoints.push_back(std::move(point));
+        retrievedPointsLock.unlock();
+    });
+}
+
+std::vector<Point>
+DataServer::retrievePoints_FromFiles(const std::vector<std::string> &filenames) {
+    auto t0_retrievePoints = CLOCK::now();  //  for logging, profiling, DBG// logging
+
+    std::vector<std::future<void> > futures;
+    futures.reserve(filenames.size());
+    for (const std::string &filename: filenames)
+        futures.push_back(threadPool.submit(&DataServer::retrievePoints_File_Thread, this, std::cref(filename)));
+    threadPool.wait(futures);
+
+    loggerDataServer.log(
+            printDuration(t0_retrievePoints, "retrievePoints_FromFiles"));
+
+    return retrievedPoints;
+}
+
 const std::vector<std::vector<Point> > &
 DataServer::pickRandomPoints(
         const std::vector<Point> &points,
@@ -90,7 +115,8 @@ DataServer::pickRandomPoints(
 ) {
     auto t0_rndPoints = CLOCK::now();     //  for logging, profiling, DBG
 
-    if (points.empty() || m > points.size()) return randomPointsList;
+    //  the last dim takes m^DIM of the points
+    if (points.empty() || std::pow(m, DIM) > points.size()) return randomPointsList;
 
     for (int dim = 0; dim < DIM; ++dim) {
 
@@ -114,7 +140,15 @@ DataServer::pickRandomPoints(
         for (int i = 0; i < pow(m, dim + 1); ++i) {
             randomPointsList[dim].emplace_back(retrievedPoints[indices[i]]);
         }
+
+        //  sorted by the coordinate of their dim, so a slice is bracketed by 2 consecutive reps
+        //  (see \fn{isInSlice})
+        randomPointsList[dim] = Point::sortByDim(std::move(randomPointsList[dim]), dim, &threadPool);
     }
+    std::vector<Ctxt *> ctxts;
+    for (std::vector<Point> &reps: randomPointsList)
+        for (Point &rep: reps) CapacityMonitor::addCtxts(ctxts, rep);
+    capacityMonitor.checkpoint("sortRandomPoints", ctxts, threadPool);
 
     loggerDataServer.log(printDuration(t0_rndPoints, "pickRandomPoints"));
     return randomPointsList;
@@ -128,110 +162,74 @@ DataServer::createCmpDict(
 ) {
     auto t0_cmpDict = CLOCK::now();     //  for logging, profiling, DBG
 
-    std::vector<
-            std::unordered_map<
-                    const Point,
-                    std::unordered_map<
-                            const Point,
-                            helib::Ctxt> > >
-            cmpDict(DIM);
-
-    std::vector<CBit> res;
-
-    for (short dim = 0; dim < DIM; ++dim) {
-        cmpDict[dim].reserve(randomPoints[dim].size());
-        for (const Point &rep: randomPoints[dim]) {
-            for (const Point &point: allPoints) {
-                //                if (!cmpDict[rep].empty() && !cmpDict[rep][point].isEmpty()))
-                //                if (rep == point) continue; //this is checked inside isBigger function
-                // todo in the future, for efficiency - check if exist
-                res = rep.isBiggerThan(point, dim);
-                /*
-                //  nand = !(mu*nu) = 1-(mu*nu)     meaning both numbers were equal
-                Ctxt nand(res[0]);              // nand = mu
-                (nand *= res[1]).negate();      // nand = - (mu * nu)
-                nand.addConstant(1l);      // nand = 1 - (mu * nu) = !(mu*nu)
-
-                //  beq = mu OR nand = mu + nand - mu * nand
-                Ctxt beq(res[0]);               // beq = mu
-                (beq *= nand).negate();           // beq = - (mu * nand)
-                (beq += res[0]) += nand;            // beq = mu + nand - (mu * nand) = mu OR nand
+    CmpDict cmpDict;
+    cmpDict.init(randomPoints, allPoints, tinyRandomPoint);
 
-                cmpDict[dim][rep].emplace(point, nand);   //  rep > point or rep=point
-                */
-                cmpDict[dim][rep].emplace(point, res[0]);   //  rep > point
-                cmpDict[dim][point].emplace(rep, res[1]);   //  rep < point
-            }
-            res = rep.isBiggerThan(tinyRandomPoint, dim);
-            cmpDict[dim][rep].emplace(tinyRandomPoint, res[0]);   //  rep > point2
-            cmpDict[dim][tinyRandomPoint].emplace(rep, res[1]);   //  rep < point2
-        }
-    }
+    long computed = 0;
+    for (short dim = 0; dim < DIM; ++dim)
+        for (long rep = 0; rep < cmpDict.numOfReps(dim); ++rep)
+            computed += cmpDict.compareRep(dim, rep);
+    cmpDict.mirrorRepPairs();
 
-    loggerDataServer.log(printDuration(t0_cmpDict, "createCmpDict"));
+    loggerDataServer.log(printDuration(t0_cmpDict, "createCmpDict (" + std::to_string(computed) + " comparisons)"));
     return cmpDict;
 }
 
-void
-DataServer::createCmpDict_Dim_Thread(short dim) {
-
-    auto t0_cmpDict_thread = CLOCK::now();     //  for logging, profiling, DBG
-    std::vector<CBit> res;
-    cmpDict[dim].reserve(randomPointsList[dim].size());
-
-    for (Point &rep: randomPointsList[dim]) {
-        for (Point &point: retrievedPoints) {
-            //                if (!cmpDict[rep].empty() && !cmpDict[rep][point].isEmpty()))
-            //                if (rep == point) continue; //this is checked inside isBigger function
-            // todo in the future, for efficiency - check if exist
-            res = rep.isBiggerThan(point, dim);
-            /*
-            //  nand = !(mu*nu) = 1-(mu*nu)     meaning both numbers were equal
-            Ctxt nand(res[0]);              // nand = mu
-            (nand *= res[1]).negate();      // nand = - (mu * nu)
-            nand.addConstant(1l);      // nand = 1 - (mu * nu) = !(mu*nu)
-
-            //  beq = mu OR nand = mu + nand - mu * nand
-            Ctxt beq(res[0]);               // beq = mu
-            (beq *= nand).negate();           // beq = - (mu * nand)
-            (beq += res[0]) += nand;            // beq = mu + nand - (mu * nand) = mu OR nand
-
-            cmpDict[dim][rep].emplace(point, nand);   //  rep > point or rep=point
-            */
-            cmpDictLock.lock();
-            cmpDict[dim][rep].emplace(point, res[0]);   //  rep > point
-            cmpDict[dim][point].emplace(rep, res[1]);   //  rep < point
-            cmpDictLock.unlock();
-        }
-        res = rep.isBiggerThan(tinyRandomPoint, dim);
-        cmpDictLock.lock();
-        cmpDict[dim][rep].emplace(tinyRandomPoint, res[0]);   //  rep > point2
-        cmpDict[dim][tinyRandomPoint].emplace(rep, res[1]);   //  rep < point2
-        cmpDictLock.unlock();
-    }
-    loggerDataServer.log(printDuration(t0_cmpDict_thread, "createCmpDict_Dim_Thread"));
-}
-
 CmpDict &
 DataServer::createCmpDict_WithThreads(const std::vector<Point> &allPoints,
                                       const std::vector<std::vector<Point> > &randomPoints,
                                       int numOfThreads) {
     auto t0_cmpDict_withThreads = CLOCK::now();     //  for logging, profiling, DBG
 
-    std::vector<std::thread> threadVec;
+    //  the whole dict is allocated up front, and every (dim, rep) row is filled by its own task - no locks needed
+    cmpDict.init(randomPoints, allPoints, tinyRandomPoint);
 
+    std::vector<std::future<long> > futures;
     for (short dim = 0; dim < DIM; ++dim)
-        threadVec.emplace_back(
-                &DataServer::createCmpDict_Dim_Thread,
-                this,
-                dim);
-    for (auto &t: threadVec) t.join();
+        for (long rep = 0; rep < cmpDict.numOfReps(dim); ++rep)
+            futures.push_back(threadPool.submit(&CmpDict::compareRep, &cmpDict, dim, rep));
+    long computed = 0;
+    for (std::future<long> &future: futures) computed += threadPool.wait(future);
+    //  the rows are done - the rep pairs compared by one row are shared with the other
+    cmpDict.mirrorRepPairs();
+
+    std::vector<Ctxt *> ctxts;
+    cmpDict.collectCtxts(ctxts);
+    capacityMonitor.checkpoint("createCmpDict", ctxts, threadPool);
 
     loggerDataServer.log(
-            printDuration(t0_cmpDict_withThreads, "createCmpDict_WithThreads"));
+            printDuration(t0_cmpDict_withThreads,
+                          "createCmpDict_WithThreads (" + std::to_string(computed) + " comparisons)"));
     return cmpDict;
 }
 
+/**
+ * @brief is p in the slice of the rep sortedReps[k] (in dim) - the AND of all of these:
+ *  the given conditions (e.g. the rep and p are in the base slice),
+ *  p <= sortedReps[k], and p > sortedReps[k - 1].
+ * the reps are sorted (see \fn{Point::sortByDim}), so the 2 consecutive reps bracket the slice -
+ *  2 comparisons per point, instead of a term per rep (which "p is above all the reps below R" took unsorted).
+ *  all the conditions are multiplied together by helib::totalProduct, in a balanced tree.
+ * */
+static CBit isInSlice(const CmpDict &cmpDict,
+                      int dim,
+                      const Point &p,
+                      const std::vector<Point> &sortedReps,
+                      long k,
+                      std::vector<CBit> &&conditions) {
+    conditions.reserve(conditions.size() + 2);
+    //  p <= R  =  1 - (p > R)
+    CBit pIsNotAboveCurrentRep(cmpDict.isBigger(dim, p, sortedReps[k]));
+    pIsNotAboveCurrentRep.addConstant(NTL::ZZX(1L));
+    conditions.push_back(std::move(pIsNotAboveCurrentRep));
+    //  p > the previous rep (nothing is below the first one, which is the tiny point at the most)
+    if (0 < k) conditions.push_back(cmpDict.isBigger(dim, p, sortedReps[k - 1]));
+
+    CBit isIn(p.public_key);
+    helib::totalProduct(isIn, conditions);
+    return isIn;
+}
+
 std::map<int, //DIM
         std::vector< //current slices for approp dimension
                 Slice
@@ -250,21 +248,21 @@ DataServer::splitIntoEpsNet(
     // initialize base level of data
     Slice startingSlice;
     for (auto const &point: points)
-        startingSlice.addPoint(point, cmpDict[0].at(point).at(tinyRandomPoint));
-    slices[-1].push_back(startingSlice);
+        startingSlice.addPoint(point, cmpDict.isBigger(0, point, tinyRandomPoint));
+    slices[-1].push_back(std::move(startingSlice));
 
     /**     for DBG  (todo remove)    **/
     long PisRepInPrevSlice;// = keysServer.decryptCtxt(isRepInPrevSlice);
     long PisInGroup;// = keysServer.decryptCtxt(isInGroup);
-    long PpIsBelowCurrentRep;// = keysServer.decryptCtxt(pIsBelowCurrentRep);
-    long PpIsAboveAllSmallerReps;// = keysServer.decryptCtxt(pIsAboveAllSmallerReps);
-    long PotherRepIsAboveCurrentRep;// = keysServer.decryptCtxt(otherRepIsAboveCurrentRep);
-    long PpIsAboveOtherSmallerRep;// = keysServer.decryptCtxt(pIsAboveOtherSmallerRep);
-    long PpIsBelowCurrentRepAndAboveOtherRep;// = keysServer.decryptCtxt(pIsBelowCurrentRepAndAboveOtherRep);
 
     for (int dim = 0; dim < DIM; ++dim) {
         auto t0_itr_dim = CLOCK::now();     //  for logging, profiling, DBG
 
+        //  one copy of each rep, shared by all the slices it splits
+        std::vector<PointHandle> reps;
+        reps.reserve(randomPoints[dim].size());
+        for (const Point &R: randomPoints[dim]) reps.push_back(std::make_shared<const Point>(R));
+
         for (const Slice &baseSlice: slices[dim - 1]) {
             auto t0_itr_slice = CLOCK::now();     //  for logging, profiling, DBG
             /*
@@ -281,8 +279,10 @@ DataServer::splitIntoEpsNet(
             //                                                          | Rj from random_points[DIM-1] }
             */
 
-            for (const Point &R: randomPoints[dim]) {
+            for (long k = 0; k < reps.size(); ++k) {
                 auto t0_itr_rep = CLOCK::now();     //  for logging, profiling, DBG
+                const PointHandle &rep = reps[k];
+                const Point &R = *rep;
 
                 /*
                                     cout << endl << endl;
@@ -296,28 +296,31 @@ DataServer::splitIntoEpsNet(
 
                 Slice newSlice;
                 newSlice.addReps(baseSlice.reps);
-                newSlice.addRep(R);
+                newSlice.addRep(rep);
 
-                CBit isRepInPrevSlice(cmpDict[dim].at(R).at(
-                        R)); //todo or cmpDict[dim].at(R).at(tinyRandPoint)
+                CBit isRepInPrevSlice(cmpDict.isBigger(dim, R, R)); //todo or cmpDict.isBigger(dim, R, tinyRandPoint)
 
-                if (0 < dim && !baseSlice.reps.empty())
-                    // does this rep belong to the slice
-                    isRepInPrevSlice *= cmpDict[dim - 1].at(baseSlice.reps[dim - 1]).at(R);
+                if (0 < dim && !baseSlice.reps.empty()) {
+                    // does this rep belong to the slice - R <= the base rep, inclusive like the points (see isInSlice):
+                    //  the reps are sorted copies with fresh ids, so a rep of both dims is no longer "the same point"
+                    CBit isRepNotAbove(cmpDict.isBigger(dim - 1, R, *baseSlice.reps[dim - 1]));
+                    isRepNotAbove.addConstant(NTL::ZZX(1L));
+                    isRepInPrevSlice *= isRepNotAbove;
+                }
                 PisRepInPrevSlice = keysServer.decryptCtxt(isRepInPrevSlice);
                 // todo why cmp at prev dim and not current?
 
                 //  tailSlice.addRep(R);
 
                 //                    for (const Point &p:baseSlice.points) {
-                for (const PointTuple &pointTuple: baseSlice.pointTuples) {
+                for (long i = 0; i < baseSlice.points.size(); ++i) {
 
                     //                        const Point &p = pointTuple.point;
-                    const Point &p = pointTuple.first;
+                    const Point &p = baseSlice.points[i];
                     // if current poins is the current Rep no need to add it now - it will be added to the group later
                     //                        if (R==p) continue; //  R==p means R.id==p.id
                     //                        CBit isPointInPrevSlice(pointTuple.isIn);
-                    CBit isPointInPrevSlice(pointTuple.second);
+                    CBit isPointInPrevSlice(baseSlice.counter[i]);
 
                     /*
                      if (p == R) continue;
@@ -333,68 +336,10 @@ DataServer::splitIntoEpsNet(
                                             cout << "}";
                     */
 
-                    CBit isInGroup = isRepInPrevSlice;
-                    isInGroup *= isPointInPrevSlice;
-
-                    // p < R
-                    CBit pIsBelowCurrentRep(cmpDict[dim].at(R).at(p));
-                    PpIsBelowCurrentRep = keysServer.decryptCtxt(pIsBelowCurrentRep);
-
-                    CBit pIsAboveAllSmallerReps(pIsBelowCurrentRep); //todo other init
-
-                    for (const Point &r: randomPoints[dim]) {
-                        /*                            cout << "       --- other r: ";
-                                                    printPoint(r, keysServer);*/
-                        if ((r == R) || (p == r)) continue;
-                        // make sure with adi and dan current solution makes sense
-
-                        //  r > R (in which case we don't care about cmpDict results of p and r)
-                        CBit otherRepIsAboveCurrentRep = cmpDict[dim].at(r).at(R);
-                        // results in: CBit otherRepIsAboveCurrentRep = (r > R)
-
-                        //  R > r    AND     p > r
-                        CBit pIsAboveOtherSmallerRep(cmpDict[dim].at(R).at(r));
-                        // results in: CBit pIsAboveOtherSmallerRep = (R > r)
-                        pIsAboveOtherSmallerRep *= (cmpDict[dim].at(p).at(r));
-                        // results in: CBit pIsAboveOtherSmallerRep = (R > r) * (p > r)
-
-                        //   [ R > r    AND     p > r ]   OR   r > R
-                        //  should be   [ (R > r) * (p > r) ] + (r > R) - [ (R > r) * (p > r) ] * (r > R)
-                        //  actually is [ (R > r) * (p > r) ] + (r > R) - [ (R > r) * (p > r) ] * (r > R)
-                        CBit pIsBelowCurrentRepAndAboveOtherRep = pIsAboveOtherSmallerRep;
-                        // results in: CBit pIsBelowCurrentRepAndAboveOtherRep
-                        // = (R > r) * (p > r)
-                        pIsBelowCurrentRepAndAboveOtherRep *= otherRepIsAboveCurrentRep;
-                        // results in: CBit pIsBelowCurrentRepAndAboveOtherRep
-                        // = [(R > r) * (p > r)] * (r > R)
-                        pIsBelowCurrentRepAndAboveOtherRep.negate();
-                        // results in: CBit pIsBelowCurrentRepAndAboveOtherRep
-                        // =  - [(R > r) * (p > r)] * (r > R)
-                        pIsBelowCurrentRepAndAboveOtherRep += pIsAboveOtherSmallerRep;
-                        // results in: CBit pIsBelowCurrentRepAndAboveOtherRep
-                        // = [(R > r) * (p > r)] - [(R > r) * (p > r)] * (r > R)
-                        pIsBelowCurrentRepAndAboveOtherRep += otherRepIsAboveCurrentRep;
-                        PpIsBelowCurrentRepAndAboveOtherRep = keysServer.decryptCtxt(
-                                pIsBelowCurrentRepAndAboveOtherRep);
-
-                        // results in: CBit pIsBelowCurrentRepAndAboveOtherRep
-                        // = (r > R) + [(R > r) * (p > r)]- [(R > r) * (p > r)] * (r > R)
-                        // results in: CBit pIsBelowCurrentRepAndAboveOtherRep =
-                        // pIsAboveOtherSmallerRep + otherRepIsAboveCurrentRep
-                        // - pIsAboveOtherSmallerRep * otherRepIsAboveCurrentRep
-                        PotherRepIsAboveCurrentRep = keysServer.decryptCtxt(
-                                otherRepIsAboveCurrentRep);
-                        PpIsAboveOtherSmallerRep = keysServer.decryptCtxt(
-                                pIsAboveOtherSmallerRep);
-
-                        // this will hold the Product[ (R > r) && (p > r) | foreach r in randomPoints ]
-                        pIsAboveAllSmallerReps *= pIsBelowCurrentRepAndAboveOtherRep;
-                        PpIsAboveAllSmallerReps = keysServer.decryptCtxt(
-                                pIsAboveAllSmallerReps);
-                    }
-
-                    isInGroup *= pIsBelowCurrentRep;
-                    isInGroup *= pIsAboveAllSmallerReps;
+                    //  between the 2 consecutive reps that bracket the slice
+                    CBit isInGroup = isInSlice(cmpDict, dim, p,
+                                               randomPoints[dim], k,
+                                               {isRepInPrevSlice, isPointInPrevSlice});
                     PisInGroup = keysServer.decryptCtxt(isInGroup);
 
                     Point pointIsInSlice = p * isInGroup;
@@ -430,10 +375,10 @@ DataServer::splitIntoEpsNet(
                             cout << "\t\t$$$$$$";
                         }*/
 
-                    newSlice.addPoint(pointIsInSlice, isInGroup);
+                    newSlice.addPoint(std::move(pointIsInSlice), std::move(isInGroup));
                 }
 
-                slices[dim].emplace_back(newSlice);
+                slices[dim].emplace_back(std::move(newSlice));
 
                 loggerDataServer.log(printDuration(t0_itr_rep, "Split Random-Rep iteration"));
             }
@@ -443,9 +388,9 @@ DataServer::splitIntoEpsNet(
             Slice tailSlice;
             for (const Point &p:baseSlice.points) {
                 // init separate counter for tail points
-                CBit pIsAboveAllReps = cmpDict[dim].at(p).at(tinyRandomPoint);
+                CBit pIsAboveAllReps = cmpDict.isBigger(dim, p, tinyRandomPoint);
                 for (const Point &R: randomPoints[dim])
-                    pIsAboveAllReps *= cmpDict[dim].at(p).at(R);
+                    pIsAboveAllReps *= cmpDict.isBigger(dim, p, R);
                 tailSlice.addPoint(p * pIsAboveAllReps, pIsAboveAllReps);
             }
             slices[dim].emplace_back(tailSlice);
@@ -459,23 +404,18 @@ DataServer::splitIntoEpsNet(
                 "Split iteration for #" + std::to_string(dim) + " dimension"));
     }
     loggerDataServer.log(printDuration(t0_split, "splitIntoEpsNet"));
-
-    /*       todo  checkout this function, from @file Ctxt.h, could be used for all iterarion of 2nd rep at once?
-            // set out=prod_{i=0}^{n-1} v[j], takes depth log n and n-1 products
-            // out could point to v[0], but having it pointing to any other v[i]
-            // will make the result unpredictable.
-            void totalProduct(Ctxt& out, const std::vector<Ctxt>& v);
-            */
     return slices;
 }
 
 void
 DataServer::splitIntoEpsNet_R_Thread(
         const Slice &baseSlice,
-        const Point &R,
-        int dim
+        const PointHandle &rep,
+        int dim,
+        long index
 ) {
     auto t0_itr_rep = CLOCK::now();     //  for logging, profiling, DBG
+    const Point &R = *rep;
 
     /*
             cout << endl << endl;
@@ -489,36 +429,34 @@ DataServer::splitIntoEpsNet_R_Thread(
     /**     for DBG  (todo remove)    **/
     long PisRepInPrevSlice;// = keysServer.decryptCtxt(isRepInPrevSlice);
     long PisInGroup;// = keysServer.decryptCtxt(isInGroup);
-    long PpIsBelowCurrentRep;// = keysServer.decryptCtxt(pIsBelowCurrentRep);
-    long PpIsAboveAllSmallerReps;// = keysServer.decryptCtxt(pIsAboveAllSmallerReps);
-    long PotherRepIsAboveCurrentRep;// = keysServer.decryptCtxt(otherRepIsAboveCurrentRep);
-    long PpIsAboveOtherSmallerRep;// = keysServer.decryptCtxt(pIsAboveOtherSmallerRep);
-    long PpIsBelowCurrentRepAndAboveOtherRep;// = keysServer.decryptCtxt(pIsBelowCurrentRepAndAboveOtherRep);
 
     Slice newSlice;
     newSlice.addReps(baseSlice.reps);
-    newSlice.addRep(R);
+    newSlice.addRep(rep);
 
-    CBit isRepInPrevSlice(cmpDict[dim].at(R).at(
-            R)); //todo or cmpDict[dim].at(R).at(tinyRandPoint)
+    CBit isRepInPrevSlice(cmpDict.isBigger(dim, R, R)); //todo or cmpDict.isBigger(dim, R, tinyRandPoint)
 
-    if (0 < dim && !baseSlice.reps.empty())
-        // does this rep belong to the slice
-        isRepInPrevSlice *= cmpDict[dim - 1].at(baseSlice.reps[dim - 1]).at(R);
+    if (0 < dim && !baseSlice.reps.empty()) {
+        // does this rep belong to the slice - R <= the base rep, inclusive like the points (see isInSlice):
+        //  the reps are sorted copies with fresh ids, so a rep of both dims is no longer "the same point"
+        CBit isRepNotAbove(cmpDict.isBigger(dim - 1, R, *baseSlice.reps[dim - 1]));
+        isRepNotAbove.addConstant(NTL::ZZX(1L));
+        isRepInPrevSlice *= isRepNotAbove;
+    }
     PisRepInPrevSlice = keysServer.decryptCtxt(isRepInPrevSlice);
     // todo why cmp at prev dim and not current?
 
     //  tailSlice.addRep(R);
 
     //                    for (const Point &p:baseSlice.retrievedPoints) {
-    for (const PointTuple &pointTuple: baseSlice.pointTuples) {
+    for (long i = 0; i < baseSlice.points.size(); ++i) {
 
         //                        const Point &p = pointTuple.point;
-        const Point &p = pointTuple.first;
+        const Point &p = baseSlice.points[i];
         // if current poins is the current Rep no need to add it now - it will be added to the group later
         //                        if (R==p) continue; //  R==p means R.id==p.id
         //                        CBit isPointInPrevSlice(pointTuple.isIn);
-        CBit isPointInPrevSlice(pointTuple.second);
+        CBit isPointInPrevSlice(baseSlice.counter[i]);
 
         /*
          if (p == R) continue;
@@ -534,68 +472,10 @@ DataServer::splitIntoEpsNet_R_Thread(
                                 cout << "}";
         */
 
-        CBit isInGroup = isRepInPrevSlice;
-        isInGroup *= isPointInPrevSlice;
-
-        // p < R
-        CBit pIsBelowCurrentRep(cmpDict[dim].at(R).at(p));
-        PpIsBelowCurrentRep = keysServer.decryptCtxt(pIsBelowCurrentRep);
-
-        CBit pIsAboveAllSmallerReps(pIsBelowCurrentRep); //todo other init
-
-        for (const Point &r: randomPointsList[dim]) {
-            /*                            cout << "       --- other r: ";
-                                        printPoint(r, keysServer);*/
-            if ((r == R) || (p == r)) continue;
-            // make sure with adi and dan current solution makes sense
-
-            //  r > R (in which case we don't care about cmpDict results of p and r)
-            CBit otherRepIsAboveCurrentRep = cmpDict[dim].at(r).at(R);
-            // results in: CBit otherRepIsAboveCurrentRep = (r > R)
-
-            //  R > r    AND     p > r
-            CBit pIsAboveOtherSmallerRep(cmpDict[dim].at(R).at(r));
-            // results in: CBit pIsAboveOtherSmallerRep = (R > r)
-            pIsAboveOtherSmallerRep *= (cmpDict[dim].at(p).at(r));
-            // results in: CBit pIsAboveOtherSmallerRep = (R > r) * (p > r)
-
-            //   [ R > r    AND     p > r ]   OR   r > R
-            //  should be   [ (R > r) * (p > r) ] + (r > R) - [ (R > r) * (p > r) ] * (r > R)
-            //  actually is [ (R > r) * (p > r) ] + (r > R) - [ (R > r) * (p > r) ] * (r > R)
-            CBit pIsBelowCurrentRepAndAboveOtherRep = pIsAboveOtherSmallerRep;
-            // results in: CBit pIsBelowCurrentRepAndAboveOtherRep
-            // = (R > r) * (p > r)
-            pIsBelowCurrentRepAndAboveOtherRep *= otherRepIsAboveCurrentRep;
-            // results in: CBit pIsBelowCurrentRepAndAboveOtherRep
-            // = [(R > r) * (p > r)] * (r > R)
-            pIsBelowCurrentRepAndAboveOtherRep.negate();
-            // results in: CBit pIsBelowCurrentRepAndAboveOtherRep
-            // =  - [(R > r) * (p > r)] * (r > R)
-            pIsBelowCurrentRepAndAboveOtherRep += pIsAboveOtherSmallerRep;
-            // results in: CBit pIsBelowCurrentRepAndAboveOtherRep
-            // = [(R > r) * (p > r)] - [(R > r) * (p > r)] * (r > R)
-            pIsBelowCurrentRepAndAboveOtherRep += otherRepIsAboveCurrentRep;
-            PpIsBelowCurrentRepAndAboveOtherRep = keysServer.decryptCtxt(
-                    pIsBelowCurrentRepAndAboveOtherRep);
-
-            // results in: CBit pIsBelowCurrentRepAndAboveOtherRep
-            // = (r > R) + [(R > r) * (p > r)]- [(R > r) * (p > r)] * (r > R)
-            // results in: CBit pIsBelowCurrentRepAndAboveOtherRep =
-            // pIsAboveOtherSmallerRep + otherRepIsAboveCurrentRep
-            // - pIsAboveOtherSmallerRep * otherRepIsAboveCurrentRep
-            PotherRepIsAboveCurrentRep = keysServer.decryptCtxt(
-                    otherRepIsAboveCurrentRep);
-            PpIsAboveOtherSmallerRep = keysServer.decryptCtxt(
-                    pIsAboveOtherSmallerRep);
-
-            // this will hold the Product[ (R > r) && (p > r) | foreach r in randomPoints ]
-            pIsAboveAllSmallerReps *= pIsBelowCurrentRepAndAboveOtherRep;
-            PpIsAboveAllSmallerReps = keysServer.decryptCtxt(
-                    pIsAboveAllSmallerReps);
-        }
-
-        isInGroup *= pIsBelowCurrentRep;
-        isInGroup *= pIsAboveAllSmallerReps;
+        //  between the 2 consecutive reps that bracket the slice
+        CBit isInGroup = isInSlice(cmpDict, dim, p,
+                                   randomPointsList[dim], index % long(splitReps[dim].size()),
+                                   {isRepInPrevSlice, isPointInPrevSlice});
         PisInGroup = keysServer.decryptCtxt(isInGroup);
 
         Point pointIsInSlice = p * isInGroup;
@@ -631,13 +511,31 @@ DataServer::splitIntoEpsNet_R_Thread(
                 cout << "\t\t$$$$$$";
             }*/
 
-        newSlice.addPoint(pointIsInSlice, isInGroup);
+        newSlice.addPoint(std::move(pointIsInSlice), std::move(isInGroup));
     }
-    slicesLock.lock();
-    slices[dim].emplace_back(newSlice);
-    slicesLock.unlock();
+    //  the tasks run concurrently - map::operator[] may insert, so only at() (a lookup) is safe here.
+    //  all the dims were inserted before the graph started
+    Slice &slice = slices.at(dim)[index];
+    slice = std::move(newSlice);
 
     loggerDataServer.log(printDuration(t0_itr_rep, "Split Random-Rep Thread"));
+
+    //  this slice is done - split it by the next dim right away, with no barrier on the rest of this dim
+    if (dim + 1 < DIM) submitSplitTasks(slice, index, dim + 1);
+}
+
+void DataServer::submitSplitTasks(const Slice &baseSlice, long baseIndex, int dim) {
+    const std::vector<PointHandle> &reps = splitReps[dim];
+    for (long i = 0; i < reps.size(); ++i) {
+        std::future<void> future = threadPool.submit(&DataServer::splitIntoEpsNet_R_Thread,
+                                                     this,
+                                                     std::cref(baseSlice),
+                                                     std::cref(reps[i]),
+                                                     dim,
+                                                     baseIndex * long(reps.size()) + i);
+        std::lock_guard<std::mutex> lock(splitTasksLock);
+        splitTasks.push_back(std::move(future));
+    }
 }
 
 
@@ -655,72 +553,56 @@ DataServer::splitIntoEpsNet_WithThreads(const std::vector<Point> &points,
     // initialize base level of data
     Slice startingSlice;
     for (auto const &point: retrievedPoints)
-        startingSlice.addPoint(point, cmpDict[0].at(point).at(tinyRandomPoint));
-    slices[-1].push_back(startingSlice);
+        startingSlice.addPoint(point, cmpDict.isBigger(0, point, tinyRandomPoint));
+    slices[-1].clear();
+    slices[-1].push_back(std::move(startingSlice));
 
+    //  one copy of each rep, shared by all the slices it splits,
+    //  and all the slices of every dim allocated up front (so a slice is never moved while it is split)
+    splitReps.assign(DIM, {});
     for (int dim = 0; dim < DIM; ++dim) {
-        auto t0_itr_dim = CLOCK::now();     //  for logging, profiling, DBG
-
-        for (const Slice &baseSlice: slices[dim - 1]) {
-            auto t0_itr_slice = CLOCK::now();     //  for logging, profiling, DBG
-            /*
-            // for each slice from the previous iteration
-            // slices[-1][m^0] = { p | p form all_points }
-            // slices[0] [m^1] = { p < Ri | p from slices[-1] | Ri from random_points[0] }
-            // slices[1] [m^2] = { p < Ri & p < Rj | p from slices[0] | Ri from random_points[0]
-            //                                                          | Rj from random_points[1] }
-            //  ...
-            // slices[DIM-1][m^DIM]  = { p < Ri & p < Rj & .... & p < Rj | p from slices[1]
-            //                                                          | Rj from random_points[0]
-            //                                                          | Rj from random_points[1]
-            //                                                          |   ...
-            //                                                          | Rj from random_points[DIM-1] }
-            */
-
-            std::vector<std::thread> threadVec;
-
-            for (const Point &R: randomPointsList[dim])
-                threadVec.emplace_back(&DataServer::splitIntoEpsNet_R_Thread,
-                                       this,
-                                       baseSlice,
-                                       R,
-                                       dim
-                );
-
-            for (auto &t: threadVec) t.join();
-
-            /*
-            // todo handle tail retrievedPoints - retrievedPoints bigger than all the random retrievedPoints at current slice
-            // init separate slice for tail retrievedPoints
-            Slice tailSlice;
-            for (const Point &p:baseSlice.retrievedPoints) {
-                // init separate counter for tail retrievedPoints
-                CBit pIsAboveAllReps = cmpDict[dim].at(p).at(tinyRandomPoint);
-                for (const Point &R: randomPoints[dim])
-                    pIsAboveAllReps *= cmpDict[dim].at(p).at(R);
-                tailSlice.addPoint(p * pIsAboveAllReps, pIsAboveAllReps);
-            }
-            slices[dim].emplace_back(tailSlice);
-             */
-            cout << endl;
-            loggerDataServer.log(
-                    printDuration(t0_itr_slice, "Split Slice iteration - With Treads"));
+        splitReps[dim].reserve(randomPointsList[dim].size());
+        for (const Point &R: randomPointsList[dim]) splitReps[dim].push_back(std::make_shared<const Point>(R));
+        slices[dim].clear();
+        slices[dim].resize(slices[dim - 1].size() * splitReps[dim].size());
+    }
+    /*
+    // slices[-1][m^0] = { p | p form all_points }
+    // slices[0] [m^1] = { p < Ri | p from slices[-1] | Ri from random_points[0] }
+    // slices[1] [m^2] = { p < Ri & p < Rj | p from slices[0] | Ri from random_points[0]
+    //                                                          | Rj from random_points[1] }
+    //  ...
+    // slices[DIM-1][m^DIM]  = { p < Ri & p < Rj & .... & p < Rj | p from slices[1]
+    //                                                          | Rj from random_points[0]
+    //                                                          | Rj from random_points[1]
+    //                                                          |   ...
+    //                                                          | Rj from random_points[DIM-1] }
+    */
+    //  the roots of the task graph - every task submits the tasks of its slice for the next dim
+    //  before it is done, so once the queue is drained the whole graph is done
+    submitSplitTasks(slices[-1].back(), 0, 0);
+    while (true) {
+        std::future<void> future;
+        {
+            std::lock_guard<std::mutex> lock(splitTasksLock);
+            if (splitTasks.empty()) break;
+            future = std::move(splitTasks.front());
+            splitTasks.pop_front();
         }
-
-
-        cout << endl;
-        loggerDataServer.log(printDuration(
-                t0_itr_dim,
-                "Split iteration for #" + std::to_string(dim) + " dimension - With Threads"));
+        threadPool.wait(future);
     }
-    loggerDataServer.log(printDuration(t0_split, "splitIntoEpsNet_WithThreads"));
+    splitReps.clear();
+    cout << endl;
+
+    //  only the last dim goes on (to the means)
+    std::vector<Ctxt *> ctxts;
+    for (Slice &slice: slices[DIM - 1]) {
+        for (Point &point: slice.points) CapacityMonitor::addCtxts(ctxts, point);
+        for (Ctxt &isIncluded: slice.counter) ctxts.push_back(&isIncluded);
+    }
+    capacityMonitor.checkpoint("splitIntoEpsNet", ctxts, threadPool);
 
-    /*       todo  checkout this function, from @file Ctxt.h, could be used for all iterarion of 2nd rep at once?
-            // set out=prod_{i=0}^{n-1} v[j], takes depth log n and n-1 products
-            // out could point to v[0], but having it pointing to any other v[i]
-            // will make the result unpredictable.
-            void totalProduct(Ctxt& out, const std::vector<Ctxt>& v);
-            */
+    loggerDataServer.log(printDuration(t0_split, "splitIntoEpsNet_WithThreads"));
     return slices;
 }
 
@@ -734,11 +616,12 @@ DataServer::calculateSlicesMeans(const std::vector<Slice> &slices) {
 
         std::vector<Point> points;
         points.reserve(slice.reps.size() + slice.points.size()); // preallocate memory
-        points.insert(points.end(), slice.reps.begin(), slice.reps.end());
+        for (const PointHandle &rep: slice.reps) points.push_back(*rep);
         points.insert(points.end(), slice.points.begin(), slice.points.end());
         Point sum(Point::addManyPoints(points, keysServer));
 
-        const Point mean(keysServer.getQuotientPoint(sum, slice.counter, DIM));
+        Point mean(keysServer.getQuotientPoint(sum, slice.counter, DIM));
+        mean.setCid(slicesMeans.size());    //  the cid of a mean is its index
 
         cout << "slice reps: ";
         printPoints(slice.reps, keysServer);
@@ -758,20 +641,15 @@ DataServer::calculateSlicesMeans(const std::vector<Slice> &slices) {
 }
 
 //  fixme i think it's better to move this inside SplitIntoEps_Thread
-void DataServer::calculateSliceMean_Slice_Thread(const Slice &slice) {
-    auto t0_means = CLOCK::now();     //  for logging, profiling, DBG
+Point DataServer::calculateSliceSum(const Slice &slice) const {
+    auto t0_sum = CLOCK::now();     //  for logging, profiling, DBG
     std::vector<Point> points;
     points.reserve(slice.reps.size() + slice.points.size()); // preallocate memory
-    points.insert(points.end(), slice.reps.begin(), slice.reps.end());
+    for (const PointHandle &rep: slice.reps) points.push_back(*rep);
     points.insert(points.end(), slice.points.begin(), slice.points.end());
     Point sum(Point::addManyPoints(points, keysServer));
-
-    const Point mean(keysServer.getQuotientPoint(sum, slice.counter, DIM));
-
-    slicesMeansLock.lock();
-    slicesMeans.emplace_back(mean, slice);
-    slicesMeansLock.unlock();
-    loggerDataServer.log(printDuration(t0_means, "calculateSliceMean_Slice_Thread"));
+    loggerDataServer.log(printDuration(t0_sum, "calculateSliceSum"));
+    return sum;
 }
 
 std::vector<std::tuple<Point, Slice> >
@@ -780,14 +658,32 @@ DataServer::calculateSlicesMeans_WithThreads(
 ) {
     auto t0_means = CLOCK::now();     //  for logging, profiling, DBG
 
-    slicesMeans.reserve(slices.size());
-    std::vector<std::thread> threadVec;
-
+    std::vector<std::future<Point> > futures;
+    futures.reserve(slices.size());
     for (const Slice &slice: slices)
-        threadVec.emplace_back(&DataServer::calculateSliceMean_Slice_Thread,
-                               this,
-                               slice);
-    for (auto &t: threadVec) t.join();
+        futures.push_back(threadPool.submit(&DataServer::calculateSliceSum,
+                                            this,
+                                            std::cref(slice)));
+
+    //  a batch of sums is sent to the keys server as soon as it is ready,
+    //  so the keys server divides it while the pool goes on with the next sums
+    std::vector<std::future<std::vector<Point> > > quotients;
+    std::vector<Point> sums;
+    std::vector<const std::vector<Ctxt> *> sizes;
+    for (long i = 0; i < slices.size(); ++i) {
+        sums.push_back(threadPool.wait(futures[i]));
+        sizes.push_back(&(slices[i].counter));
+        if (NUMBER_OF_THREADS == sums.size() || slices.size() == i + 1) {
+            quotients.push_back(keysServerChannel.getQuotientPoints(sums, sizes, DIM));
+            sums.clear();
+            sizes.clear();
+        }
+    }
+
+    slicesMeans.reserve(slicesMeans.size() + slices.size());
+    long i = 0;
+    for (std::future<std::vector<Point> > &batch: quotients)
+        for (Point &mean: batch.get()) slicesMeans.emplace_back(std::move(mean), slices[i++]);
 
     loggerDataServer.log(printDuration(t0_means, "calculateSlicesMeans_WithThreads"));
 
@@ -801,6 +697,8 @@ std::vector<Point> DataServer::collectMeans(
     std::vector<Point> means;
     means.reserve(slices.size());
     for (auto const &slice: slices) means.push_back(std::get<0>(slice));
+    //  the cid of a mean is its index, so a point's closest mean can be matched against a plaintext index
+    for (int i = 0; i < means.size(); ++i) means[i].setCid(i);
     return means;
 }
 
@@ -813,12 +711,12 @@ DataServer::collectMinimalDistancesAndClosestPoints(const std::vector<Point> &po
     minDistanceTuples.reserve(points.size());
 
     for (const Point &point: points) {
-        const std::pair<Point, EncryptedNum> &
+        std::pair<Point, EncryptedNum>
                 minDistFromMeans = point.findMinDistFromMeans(means, keysServer);
         minDistanceTuples.emplace_back(
                 point,
-                minDistFromMeans.first,
-                minDistFromMeans.second);
+                std::move(minDistFromMeans.first),
+                std::move(minDistFromMeans.second));
     }
 
     loggerDataServer.log(
@@ -828,26 +726,24 @@ DataServer::collectMinimalDistancesAndClosestPoints(const std::vector<Point> &po
 }
 
 void
-DataServer::findMinDist(
-        const Point &point,
-        const std::vector<Point> &means,
-        const KeysServer &keysServer
-) {
+DataServer::findMinDist(const Point &point) {
     auto t0_collectMinDist = CLOCK::now();
 
-    const std::pair<Point, EncryptedNum> &
-            minDistFromMeans = point.findMinDistFromMeans(means, keysServer);
+    std::vector<CBit> oneHot;
+    std::pair<Point, EncryptedNum>
+            minDistFromMeans = distanceMatrix.closest(point, &threadPool, &oneHot);
 
     minDistanceTuplesLock.lock();
+    oneHotAssignments.emplace(point.id, std::move(oneHot));
     minDistanceTuples.emplace_back(
             point,
-            minDistFromMeans.first,
-            minDistFromMeans.second);
+            std::move(minDistFromMeans.first),
+            std::move(minDistFromMeans.second));
     minDistanceTuplesLock.unlock();
 
     loggerDataServer.log(
             printDuration(t0_collectMinDist,
-                          "findMinDistFromMeans thread"));
+                          "findMinDist thread"));
 
 }
 
@@ -858,18 +754,31 @@ DataServer::collectMinimalDistancesAndClosestPoints_WithThreads(
 ) {
     auto t0_collectMinDist = CLOCK::now();
 
+    //  every distance is computed once, here, and the closest means are picked from the rows
+    distanceMatrix.compute(points, means, threadPool);
+    std::vector<Ctxt *> distances;
+    distanceMatrix.collectCtxts(distances);
+    capacityMonitor.checkpoint("distances", distances, threadPool);
+
     minDistanceTuples.reserve(points.size());
-    std::vector<std::thread> threadVec;
+    std::vector<std::future<void> > futures;
+    futures.reserve(points.size());
 
     for (const Point &point: points) {
-        threadVec.emplace_back(&DataServer::findMinDist,
-                               this,
-                               point,
-                               means,
-                               std::ref(keysServer));
+        futures.push_back(threadPool.submit(&DataServer::findMinDist,
+                                            this,
+                                            std::cref(point)));
     }
 
-    for (auto &t: threadVec) t.join();
+    threadPool.wait(futures);
+
+    std::vector<Ctxt *> ctxts;
+    for (auto &[point, closestMean, distance]: minDistanceTuples) {
+        CapacityMonitor::addCtxts(ctxts, closestMean);
+        CapacityMonitor::addCtxts(ctxts, distance);
+    }
+    for (auto &[id, oneHot]: oneHotAssignments) for (CBit &bit: oneHot) ctxts.push_back(&bit);
+    capacityMonitor.checkpoint("findMinDistFromMeans", ctxts, threadPool);
 
     loggerDataServer.log(
             printDuration(t0_collectMinDist,
@@ -880,7 +789,8 @@ DataServer::collectMinimalDistancesAndClosestPoints_WithThreads(
 
 EncryptedNum DataServer::calculateThreshold(
         const std::vector<std::tuple<Point, Point, EncryptedNum>> &minDistanceTuples,
-        int iterationNumber
+        int iterationNumber,
+        long numOfPoints
 ) {
     //  collect minimal distances
     EncryptedNum sum;
@@ -898,14 +808,14 @@ EncryptedNum DataServer::calculateThreshold(
     );
 
     //  find average distance
-    long num = long(NUMBER_OF_POINTS / pow(2, iterationNumber));
+    long num = long(numOfPoints / pow(2, iterationNumber));
     printNameVal(pow(2, iterationNumber));
     printNameVal(num);
     EncryptedNum
             threshold =
-            keysServer.getQuotient(
+            keysServerChannel.getQuotient(
                     sum,
-                    num);
+                    num).get();
     return threshold;
 }
 
@@ -927,8 +837,9 @@ std::tuple<
     std::vector<std::pair<Point, CBit> > farthest;
 
     for (auto const &tuple: minDistanceTuples) {
-        Point point = std::get<0>(tuple);
-        Point meanClosest = std::get<1>(tuple);
+        //  the tuples outlive this loop (and its tasks), so the points are only referenced - not copied
+        const Point &point = std::get<0>(tuple);
+        const Point &meanClosest = std::get<1>(tuple);
         EncryptedNum distance = std::get<2>(tuple);
         const helib::PubKey &public_key = point.public_key;
 
@@ -942,23 +853,10 @@ std::tuple<
         closest.emplace_back(point * ni, ni);
 
         for (int i = 0; i < means.size(); ++i) {
-            //  check if the closest mean to the point is the current one
-            helib::Ctxt muCid(public_key), niCid(public_key);
-            helib::CtPtrs_vectorCt closestCid(meanClosest.cid), meanCid(means[i].cid);
-            helib::compareTwoNumbers(muCid, niCid, closestCid, meanCid);
-
-            //  check if point is within margin and her closest mean equals to the current one
-            helib::Ctxt notMuCid(muCid);
-            notMuCid.negate();
-            notMuCid.addConstant(1l);
-            //  result in isCloseToCurrentMean = !(muCid)
-            helib::Ctxt isCloseToCurrentMean(niCid);
-            isCloseToCurrentMean.negate();
-            isCloseToCurrentMean.addConstant(1l);
-            isCloseToCurrentMean *= notMuCid;
-            //  result in isCloseToCurrentMean = !(muCid) && !(niCid)
+            //  check if the closest mean to the point is the current one (the cid of a mean is its index)
+            //  and if the point is within margin
+            helib::Ctxt isCloseToCurrentMean(meanClosest.hasCid(i));
             isCloseToCurrentMean *= ni;
-            //  result in isCloseToCurrentMean = !(muCid) && !(niCid) && ni
 
             //  pick all points with distance smaller than avg, arrange by closest mean point
             groups[i].emplace_back(point * isCloseToCurrentMean, isCloseToCurrentMean);
@@ -971,32 +869,18 @@ std::tuple<
     return {groups, closest, farthest};
 }
 
-void DataServer::choosePoint_Mean_Thread(Point point,
-                                         Point meanClosest,
+void DataServer::choosePoint_Mean_Thread(const Point &point,
+                                         const Point &meanClosest,
                                          std::vector<Point> &means,
                                          int i,
                                          Ctxt ni
 ) {
     auto t0_choosePoint_Thread = CLOCK::now();
 
-    //  check if the closest mean to the point is the current one
-    const helib::PubKey &public_key = point.public_key;
-    helib::Ctxt muCid(public_key), niCid(public_key);
-    helib::CtPtrs_vectorCt closestCid(meanClosest.cid), meanCid(means[i].cid);
-    helib::compareTwoNumbers(muCid, niCid, closestCid, meanCid);
-
-    //  check if point is within margin and her closest mean equals to the current one
-    helib::Ctxt notMuCid(muCid);
-    notMuCid.negate();
-    notMuCid.addConstant(1l);
-    //  result in isCloseToCurrentMean = !(muCid)
-    helib::Ctxt isCloseToCurrentMean(niCid);
-    isCloseToCurrentMean.negate();
-    isCloseToCurrentMean.addConstant(1l);
-    isCloseToCurrentMean *= notMuCid;
-    //  result in isCloseToCurrentMean = !(muCid) && !(niCid)
+    //  check if the closest mean to the point is the current one (the cid of a mean is its index)
+    //  and if the point is within margin
+    helib::Ctxt isCloseToCurrentMean(meanClosest.hasCid(i));
     isCloseToCurrentMean *= ni;
-    //  result in isCloseToCurrentMean = !(muCid) && !(niCid) && ni
 
     //  pick all points with distance smaller than avg, arrange by closest mean point
     groupsLock.lock();
@@ -1017,11 +901,12 @@ std::tuple<
 ) {
     auto t0_choosePoint = CLOCK::now();
 
-    std::vector<std::thread> threadVec;
+    std::vector<std::future<void> > futures;
 
     for (auto const &tuple: minDistanceTuples) {
-        Point point = std::get<0>(tuple);
-        Point meanClosest = std::get<1>(tuple);
+        //  the tuples outlive this loop (and its tasks), so the points are only referenced - not copied
+        const Point &point = std::get<0>(tuple);
+        const Point &meanClosest = std::get<1>(tuple);
         EncryptedNum distance = std::get<2>(tuple);
         const helib::PubKey &public_key = point.public_key;
 
@@ -1035,23 +920,20 @@ std::tuple<
         //        closest.emplace_back(point * ni, ni);
 
         for (int i = 0; i < means.size(); ++i)
-            threadVec.emplace_back(
+            futures.push_back(threadPool.submit(
                     &DataServer::choosePoint_Mean_Thread,
                     this,
-//                    std::ref(point),
-                    point,
-//                    std::ref(meanClosest),
-                    meanClosest,
+                    std::cref(point),
+                    std::cref(meanClosest),
                     std::ref(means),
 //                    means,
                     i,
 //                    std::ref(ni)
                     ni
-            );
-//        for (std::thread &t:threadVec) t.join();  //  fixme
+            ));
 
     }
-    for (std::thread &t: threadVec) t.join();  //  fixme
+    threadPool.wait(futures);
 
     loggerDataServer.log(
             printDuration(t0_choosePoint, "choosePointsByDistance_WithThreads_slower"));
@@ -1066,8 +948,8 @@ DataServer::choosePoint_Point_Thread(
         EncryptedNum &threshold
 ) {
     auto t0_choosePoint_Thread = CLOCK::now();
-    Point point = std::get<0>(tuple);
-    Point meanClosest = std::get<1>(tuple);
+    const Point &point = std::get<0>(tuple);
+    const Point &meanClosest = std::get<1>(tuple);
     EncryptedNum distance = std::get<2>(tuple);
     const helib::PubKey &public_key = point.public_key;
 
@@ -1089,30 +971,18 @@ DataServer::choosePoint_Point_Thread(
     //  pick all points with distance smaller than avg
     //        closest.emplace_back(point * ni, ni);
 
+    //  the one-hot assignment of the point, if its closest mean was found by
+    //  \fn{collectMinimalDistancesAndClosestPoints_WithThreads} (the tasks only read the map)
+    auto assignment = oneHotAssignments.find(point.id);
+    const std::vector<CBit> *oneHot =
+            (oneHotAssignments.end() != assignment && means.size() == assignment->second.size())
+            ? &(assignment->second) : nullptr;
+
     for (int i = 0; i < means.size(); ++i) {
-        //  check if the closest mean to the point is the current one
-        helib::Ctxt muCid(public_key), niCid(public_key);
-        helib::CtPtrs_vectorCt closestCid(meanClosest.cid), meanCid(means[i].cid);
-        helib::compareTwoNumbers(muCid,
-                                 niCid,
-                                 closestCid,
-                                 meanCid,
-                                 false,
-                                 &KeysServer::unpackSlotEncoding
-                                 );
-
-        //  check if point is within margin and her closest mean equals to the current one
-        helib::Ctxt notMuCid(muCid);
-        notMuCid.negate();
-        notMuCid.addConstant(1l);
-        //  result in isCloseToCurrentMean = !(muCid)
-        helib::Ctxt isCloseToCurrentMean(niCid);
-        isCloseToCurrentMean.negate();
-        isCloseToCurrentMean.addConstant(1l);
-        isCloseToCurrentMean *= notMuCid;
-        //  result in isCloseToCurrentMean = !(muCid) && !(niCid)
+        //  check if the closest mean to the point is the current one - a single AND with the one-hot bit
+        //  (otherwise match the cid of the closest mean, which is its index), and if the point is within margin
+        helib::Ctxt isCloseToCurrentMean(oneHot ? (*oneHot)[i] : meanClosest.hasCid(i));
         isCloseToCurrentMean *= ni;
-        //  result in isCloseToCurrentMean = !(muCid) && !(niCid) && ni
 
         //  pick all points with distance smaller than avg, arrange by closest mean point
         groupsLock.lock();
@@ -1135,17 +1005,31 @@ std::tuple<
 ) {
     auto t0_choosePoint = CLOCK::now();
 
-    std::vector<std::thread> threadVec;
+    std::vector<std::future<void> > futures;
+    futures.reserve(minDistanceTuples.size());
 
     for (auto const &tuple: minDistanceTuples)
-        threadVec.emplace_back(&DataServer::choosePoint_Point_Thread,
-                               this,
-                               tuple,
-                               std::ref(means),
-                               std::ref(threshold)
-        );
-
-    for (auto &t: threadVec) t.join();
+        futures.push_back(threadPool.submit(&DataServer::choosePoint_Point_Thread,
+                                            this,
+                                            std::cref(tuple),
+                                            std::ref(means),
+                                            std::ref(threshold)
+        ));
+
+    threadPool.wait(futures);
+
+    //  the farthest points are the points of the next iteration
+    std::vector<Ctxt *> ctxts;
+    for (auto &[point, isIn]: farthest) {
+        CapacityMonitor::addCtxts(ctxts, point);
+        ctxts.push_back(&isIn);
+    }
+    for (auto &[meanIndex, group]: groupsOfClosestPoints)
+        for (auto &[point, isIn]: group) {
+            CapacityMonitor::addCtxts(ctxts, point);
+            ctxts.push_back(&isIn);
+        }
+    capacityMonitor.checkpoint("choosePointsByDistance", ctxts, threadPool);
 
     loggerDataServer.log(
             printDuration(t0_choosePoint, "choosePointsByDistance_WithThreads"));
@@ -3,19 +3,13 @@
 #define ENCKMEAN_DATASERVER_H
 
 #include "Client.h"
+#include "CmpDict.h"
+#include "DistanceMatrix.h"
+#include "CapacityMonitor.h"
+#include "KeysServerChannel.h"
+#include "utils/ThreadPool.h"
 
 
-using CmpDict =
-const std::vector<
-        std::unordered_map<
-                const Point,
-                std::unordered_map<
-                        const Point,
-                        helib::Ctxt
-                >
-        >
->;
-
 class DataServer {
 
 protected:
@@ -26,6 +20,35 @@ protected:
 
 
 public:
+    /**
+     * @brief shared, bounded executor for all the `_WithThreads` stages.
+     * sized by #NUMBER_OF_THREADS, so that the stages never oversubscribe the machine.
+     * */
+    ThreadPool threadPool;
+
+    /**
+     * @brief the noise budget of the stage outputs - checked (and recrypted, if needed) at the end of every stage
+     *  that \fn{KeysServer::planParams} sizes L for: \fn{pickRandomPoints}, \fn{createCmpDict_WithThreads},
+     *  \fn{splitIntoEpsNet_WithThreads}, the distances and the tournament of
+     *  \fn{collectMinimalDistancesAndClosestPoints_WithThreads}, and \fn{choosePointsByDistance_WithThreads}
+     *  (the means are divided by the keys server, so they come back fresh).
+     *  the threshold of each checkpoint is the planned depth of the next stage (see \fn{KeysServer::planParams})
+     * */
+    CapacityMonitor capacityMonitor;
+
+    /**
+     * @brief the requests to the keys server (the division of the slice sums, and the threshold) go through it,
+     *  so the keys server works while the stages of the DataServer go on
+     * */
+    KeysServerChannel keysServerChannel;
+
+    /**
+     * @brief the ciphertexts of the points of a finished iteration, reused by the copies of the next one
+     *  (see \fn{clearForNextIteration}). so the copies don't allocate (from all the threads) again and again.
+     *  its capacity is set by every iteration to what the next one takes
+     * */
+    CtxtPool ctxtPool;
+
     /**
      * Constructor for \class{Client},
      * @param keysServer binds to the \class{KeysServer} responsible for the distributing the appropriate key
@@ -35,7 +58,10 @@ public:
      * */
     explicit DataServer(const KeysServer &keysServer) :
             keysServer(keysServer),
-            tinyRandomPoint(keysServer.tinyRandomPoint())
+            tinyRandomPoint(keysServer.tinyRandomPoint()),
+            threadPool(NUMBER_OF_THREADS),
+            capacityMonitor(keysServer.getPublicKey()),
+            keysServerChannel(keysServer)
     //            ,
     //            retrievedPoints(NUMBER_OF_POINTS)
     //            ,
@@ -45,28 +71,45 @@ public:
     {
         //        dataServerLogger.log("DataServer()");
         cout << "DataServer()" << endl;
-        cmpDict.resize(DIM);
         randomPointsList.resize(DIM);
         retrievedPoints.reserve(NUMBER_OF_POINTS);
+        //  recrypt only what the next stage would not survive (by the planned depths, if planned)
+        capacityMonitor.setStageDepths(keysServer.getParams().stageDepths);
+        //  w/o bootstrapping, the keys server refreshes them
+        capacityMonitor.setRefresher([this](const std::vector<Ctxt> &ctxts) {
+            return keysServerChannel.refresh(ctxts);
+        });
 
     }
 
     void clearForNextIteration(std::vector<Point> &initial_points) {
+        cmpDict.clear();
+        distanceMatrix.clear();
+        oneHotAssignments.clear();
+        capacityMonitor.clearReports();
+
+        //  the points of this iteration are done with - their ciphertexts are reused by the copies of the next one
+        //  (only as many as those copies take are kept - so the pool never holds more than the next iteration)
+        ctxtPool.setCapacity(long(initial_points.size()) * (DIM * BIT_SIZE + CID_BIT_SIZE));
+        for (Point &point: retrievedPoints) point.recycle(ctxtPool);
+        for (std::vector<Point> &randomPoints: randomPointsList)
+            for (Point &point: randomPoints) point.recycle(ctxtPool);
+        for (auto &[mean, slice]: slicesMeans) mean.recycle(ctxtPool);
+        for (auto &[point, isIn]: farthest) point.recycle(ctxtPool);
+        for (auto &[point, mean, distance]: minDistanceTuples) {
+            point.recycle(ctxtPool);
+            mean.recycle(ctxtPool);
+            ctxtPool.recycle(distance);
+        }
+        for (auto &[meanIndex, group]: groupsOfClosestPoints)
+            for (auto &[point, isIn]: group) point.recycle(ctxtPool);
+
         retrievedPoints.clear();
-        retrievedPoints.shrink_to_fit();
-        for(const Point & p:initial_points) retrievedPoints.push_back(p);
+        retrievedPoints.reserve(initial_points.size());
+        for (const Point &p: initial_points) retrievedPoints.emplace_back(p, ctxtPool);
 
         randomPointsList.clear();
         randomPointsList.resize(DIM);
-        for (int dim = 0; dim < DIM; ++dim) {
-            randomPointsList[dim].clear();
-            randomPointsList[dim].shrink_to_fit();
-        }
-
-        //todo - consider not clearing and adding a check in init_dict - if entry exists (from prev iteration) then no need to cmp
-//        cmpDict.clear(); // fixme clearing cmpDict creates bug, probably since it's a map and needs to be resized etc.
-//        cmpDict.shrink_to_fit();
-//        cmpDict.resize(DIM);
 
         slices.clear();
 //        slices.shrink_to_fit();
@@ -84,6 +127,17 @@ public:
 //        groupsOfClosestPoints.shrink_to_fit();
     }
 
+    /**
+     * @brief in streaming mode - forget everything of the previous chunk
+     *  (its points are gone, so its memory is released)
+     * */
+    void clearForNextChunk() {
+        std::vector<Point> none;
+        clearForNextIteration(none);
+        retrievedPoints.shrink_to_fit();
+        ctxtPool.clear();
+    }
+
     /**
      * @brief A simulated retrievel of data from clients.
      * @param clients - a list of clients (chosen by the CA, to share a similar public key).
@@ -107,6 +161,17 @@ public:
             short numOfThreads = NUMBER_OF_THREADS
     );
 
+    void
+    retrievePoints_File_Thread(const std::string &filename);
+
+    /**
+     * @brief retrieve the points uploaded by the clients - a \class{PointFile} per upload.
+     *  the files are read in parallel, and the points are moved straight into #retrievedPoints.
+     * @returns all the points in the files
+     * */
+    std::vector<Point>
+    retrievePoints_FromFiles(const std::vector<std::string> &filenames);
+
 
     std::vector<std::vector<Point> > randomPointsList;
 
@@ -114,7 +179,9 @@ public:
      * @brief request data from clients and conentrate into one list
      * @param points - all the points from all the clients in the data set
      * @param m - number of random representatives for each slice
-     * @returns a list of #DIM lists - each containing m^d randomly chosen points
+     * @returns a list of #DIM lists - each containing m^d randomly chosen points,
+     *  obliviously sorted by the coordinate of its dim (see \fn{Point::sortByDim}) - so new points, with new ids.
+     *  nothing is picked if there are fewer than m^DIM points
      * @return std::vector<Point>
      * */
     //    std::vector<std::vector<Point> >
@@ -133,9 +200,10 @@ public:
      * @param randomPoints - a sub group of all points (in current group).
      *  it is a vector of size #DIM, each node is a vector of size m^dim containing random reps
      * @param numOfReps - the desired number of representatives, usually the number of desired data slices.
-     * @returns a vector of #DIM dictionaries.
-     *   for each #dim the dictionary contains a pair of keys [point1,point2] and the encrypted value [point1[dim]>point[dim].
-     * @return std::vector<Point>
+     * @returns a \class{CmpDict}:
+     *   for each #dim, and for each pair [point1,point2] (one of them a rep), the encrypted value [point1[dim]>point[dim].
+     * @note the dict refers to the points by id, and does not copy them - so they must outlive its creation.
+     * @return CmpDict
      * */
     CmpDict
     createCmpDict(
@@ -143,16 +211,7 @@ public:
             const std::vector<std::vector<Point> > &randomPoints
     );
 
-    //    CmpDict cmpDict;
-    std::vector<
-            std::unordered_map<
-                    const Point,
-                    std::unordered_map<
-                            const Point,
-                            helib::Ctxt> > > cmpDict;
-    std::mutex cmpDictLock;
-
-    void createCmpDict_Dim_Thread(short dim);
+    CmpDict cmpDict;
 
     CmpDict &
     createCmpDict_WithThreads(const std::vector<Point> &allPoints,
@@ -178,12 +237,24 @@ public:
     );
 
     std::map<int, std::vector<Slice> > slices;
-    std::mutex slicesLock;
+
+    /*
+     * The threaded split is a task graph - a task per (base slice, rep) pair, for all the dims.
+     * slices[dim] is allocated up front, and every task fills its own place in it
+     *  (base slice index * number of reps + rep index), so the order is fixed and no lock is needed.
+     * As soon as a slice is done, the tasks that split it by the reps of the next dim are submitted.
+     * */
+    std::vector<std::vector<PointHandle> > splitReps;   //  [dim] - one copy of each rep, shared by all the slices
+    std::deque<std::future<void> > splitTasks;
+    std::mutex splitTasksLock;
+
+    void submitSplitTasks(const Slice &baseSlice, long baseIndex, int dim);
 
     void splitIntoEpsNet_R_Thread(
             const Slice &baseSlice,
-            const Point &R,
-            int dim);
+            const PointHandle &rep,
+            int dim,
+            long index);
 
     std::map<int, //DIM
             std::vector<Slice> // slices for approp dimension
@@ -203,12 +274,18 @@ public:
     calculateSlicesMeans(const std::vector<Slice> &slices);
 
     std::vector<std::tuple<Point, Slice> > slicesMeans;//(slices.size());
-    std::mutex slicesMeansLock;
 
-    void calculateSliceMean_Slice_Thread(
-            const Slice &slice
-    );
+    /**
+     * @brief the sum of the points of a slice, and its reps
+     * */
+    Point calculateSliceSum(const Slice &slice) const;
 
+    /**
+     * @brief the sums of the slices are calculated in parallel, and divided by their sizes by the keys server -
+     *  a batched request (see \fn{KeysServerChannel::getQuotientPoints}) per #NUMBER_OF_THREADS sums, sent as soon
+     *  as they are ready
+     * @return a list of slices and their corresponding means (in the order of the slices)
+     * */
     std::vector<std::tuple<Point, Slice> >
     calculateSlicesMeans_WithThreads(
             const std::vector<Slice> &slices
@@ -216,6 +293,7 @@ public:
 
     /**
      * @brief collect mean point from epsNet
+     * @note the cid of each mean is set to its index in the returned list (see \fn{Point::setCid})
      * */
 //    static
     std::vector<Point>
@@ -246,8 +324,24 @@ public:
     std::vector<std::tuple<Point, Point, EncryptedNum> > minDistanceTuples;
     std::mutex minDistanceTuplesLock;
 
-    void findMinDist(const Point &point, const std::vector<Point> &means, const KeysServer &keysServer);
+    //! @var distanceMatrix
+    //! the distances of all the points from all the means of the current iteration (see \fn{collectMinimalDistancesAndClosestPoints_WithThreads})
+    DistanceMatrix distanceMatrix;
 
+    //! @var oneHotAssignments
+    //! [point id] - the encrypted one-hot assignment of each point to its closest mean (a bit per mean index),
+    //! a by-product of finding the closest mean (see \fn{Point::argmin}). guarded by #minDistanceTuplesLock
+    std::unordered_map<long, std::vector<CBit> > oneHotAssignments;
+
+    void findMinDist(const Point &point);
+
+    /**
+     * @brief the parallel version of \fn{collectMinimalDistancesAndClosestPoints}.
+     *  the distances of all the points from all the means are computed once, in tiles, into #distanceMatrix,
+     *  and the closest mean of each point is found from its row. later stages may query the matrix too
+     *  (e.g. \fn{DistanceMatrix::twoClosest}), until the next iteration.
+     * @return tuples of [point, closest mean, minimal distance]
+     * */
     std::vector<std::tuple<Point, Point, EncryptedNum>>
     collectMinimalDistancesAndClosestPoints_WithThreads(
             const std::vector<Point> &points,
@@ -258,6 +352,7 @@ public:
     /**
      * @brief calculates the avarage which will be used as a threshold for picking "closest" points
      * @param minDistanceTuples
+     * @param numOfPoints the number of points the clustering started with (of the chunk, in streaming mode)
      * @return Encrypted avrage
      * @returns EncryptedNum
      * */
@@ -265,7 +360,8 @@ public:
     EncryptedNum
     calculateThreshold(
             const std::vector<std::tuple<Point, Point, EncryptedNum>> &minDistanceTuples,
-            int iterationNumber);
+            int iterationNumber,
+            long numOfPoints = NUMBER_OF_POINTS);
 
     //  collect for each mean the points closest to it
     //  for each Point also includes a bit signifying if the point is included returns
@@ -310,7 +406,8 @@ public:
             std::vector<Point> &means,
             EncryptedNum &threshold);
 
-    void choosePoint_Mean_Thread(Point point, Point meanClosest, std::vector<Point> &means, int i, Ctxt ni);
+    void choosePoint_Mean_Thread(const Point &point, const Point &meanClosest, std::vector<Point> &means, int i,
+                                 Ctxt ni);
 
     void choosePoint_Point_Thread(const std::tuple<Point, Point, EncryptedNum> &tuple, std::vector<Point> &means,
                                   EncryptedNum &threshold);
@@ -0,0 +1,127 @@
+#include "DistanceMatrix.h"
+
+static Logger loggerDistanceMatrix(log_debug, "loggerDistanceMatrix");
+
+void DistanceMatrix::compute(const std::vector<Point> &points,
+                             const std::vector<Point> &means,
+                             ThreadPool &threadPool,
+                             long tileSize) {
+    auto t0_compute = CLOCK::now();
+    clear();
+
+    this->means.reserve(means.size());
+    for (const Point &mean: means) this->means.push_back(&mean);
+    rowIndex.reserve(points.size());
+    for (long row = 0; row < points.size(); ++row) rowIndex.emplace(points[row].id, row);
+    //  allocated up front, so the tiles can be filled concurrently with no locks
+    distances.assign(points.size(), std::vector<EncryptedNum>(means.size()));
+
+    std::vector<std::future<void> > futures;
+    for (long firstRow = 0; firstRow < points.size(); firstRow += tileSize)
+        for (long firstMean = 0; firstMean < means.size(); firstMean += tileSize)
+            futures.push_back(threadPool.submit(&DistanceMatrix::computeTile,
+                                                this,
+                                                std::cref(points),
+                                                firstRow,
+                                                firstMean,
+                                                tileSize));
+    threadPool.wait(futures);
+
+    loggerDistanceMatrix.log(printDuration(t0_compute, "DistanceMatrix::compute"));
+}
+
+void DistanceMatrix::computeTile(const std::vector<Point> &points, long firstRow, long firstMean, long tileSize) {
+    long lastRow = std::min(firstRow + tileSize, long(points.size()));
+    long lastMean = std::min(firstMean + tileSize, long(means.size()));
+    for (long row = firstRow; row < lastRow; ++row)
+        for (long mean = firstMean; mean < lastMean; ++mean)
+            distances[row][mean] = Point::squaredDistance(points[row].cCoordinates,
+                                                          means[mean]->cCoordinates,
+                                                          points[row].public_key);
+}
+
+std::pair<Point, EncryptedNum>
+DistanceMatrix::closest(const Point &point, ThreadPool *threadPool, std::vector<CBit> *oneHot) const {
+    const std::vector<EncryptedNum> &distancesOfPoint = row(point);
+    std::vector<std::pair<Point, EncryptedNum> > level;
+    level.reserve(means.size());
+    for (long mean = 0; mean < means.size(); ++mean) level.emplace_back(*means[mean], distancesOfPoint[mean]);
+    return Point::argmin(std::move(level), threadPool, oneHot);
+}
+
+//  the best (and second best, if there is one) candidates of a part of the tournament, and their distances
+using TopTwo = std::vector<std::pair<Point, EncryptedNum> >;
+
+/**
+ * @brief bitwise a + cond * (a + b), like \fn{Point::select} but for a number
+ * @returns b if cond is 1, and a if it is 0
+ * */
+static EncryptedNum selectNum(const EncryptedNum &a, const EncryptedNum &b, const Ctxt &cond) {
+    EncryptedNum result(std::max(a.size(), b.size()), Ctxt(cond.getPubKey()));
+    for (long bit = 0; bit < result.size(); ++bit) {
+        if (bit < a.size()) result[bit] = a[bit];
+        Ctxt diff(result[bit]);
+        if (bit < b.size()) diff += b[bit];
+        diff *= cond;
+        result[bit] += diff;
+    }
+    return result;
+}
+
+/**
+ * @brief one match of the tournament in \fn{DistanceMatrix::twoClosest}.
+ * @note all the candidates of a come before the ones of b, so on ties a wins
+ * */
+static TopTwo mergeTopTwo(TopTwo &a, TopTwo &b) {
+    EncryptedNum eMax, eMin;
+    helib::CtPtrs_vectorCt max(eMax), min(eMin);
+    helib::Ctxt mu(a.front().first.public_key), ni(a.front().first.public_key);
+    helib::compareTwoNumbers(max, min,
+                             mu, ni,
+                             helib::CtPtrs_vectorCt(a.front().second),
+                             helib::CtPtrs_vectorCt(b.front().second),
+                             false,
+                             &(KeysServer::unpackSlotEncoding));
+    //  mu = a > b, so b wins if mu is 1
+    //  the second is the closer of the winner's second and the loser's first (if the winner has no second - the loser's first)
+    std::pair<Point, EncryptedNum> secondIfA = (1 < a.size()) ? Point::closerOf(a[1], b[0]) : b[0];
+    std::pair<Point, EncryptedNum> secondIfB = (1 < b.size()) ? Point::closerOf(a[0], b[1]) : a[0];
+
+    TopTwo merged;
+    merged.reserve(2);
+    merged.emplace_back(Point::select(a[0].first, b[0].first, mu), std::move(eMin));
+    merged.emplace_back(Point::select(secondIfA.first, secondIfB.first, mu),
+                        selectNum(secondIfA.second, secondIfB.second, mu));
+    return merged;
+}
+
+std::tuple<Point, EncryptedNum, Point, EncryptedNum>
+DistanceMatrix::twoClosest(const Point &point, ThreadPool *threadPool) const {
+    auto t0_twoClosest = CLOCK::now();
+
+    const std::vector<EncryptedNum> &distancesOfPoint = row(point);
+    std::vector<TopTwo> level;
+    level.reserve(means.size());
+    for (long mean = 0; mean < means.size(); ++mean)
+        level.push_back(TopTwo{{*means[mean], distancesOfPoint[mean]}});
+
+    //  the tournament - the winners of every level (and a candidate without a rival) go up to the next one
+    while (1 < level.size()) {
+        std::vector<TopTwo> nextLevel;
+        nextLevel.reserve((level.size() + 1) / 2);
+        if (threadPool) {
+            std::vector<std::future<TopTwo> > futures;
+            for (int i = 0; i + 1 < level.size(); i += 2)
+                futures.push_back(threadPool->submit(&mergeTopTwo, std::ref(level[i]), std::ref(level[i + 1])));
+            for (auto &future: futures) nextLevel.push_back(threadPool->wait(future));
+        } else
+            for (int i = 0; i + 1 < level.size(); i += 2) nextLevel.push_back(mergeTopTwo(level[i], level[i + 1]));
+        if (level.size() % 2) nextLevel.push_back(std::move(level.back()));
+        level = std::move(nextLevel);
+    }
+
+    loggerDistanceMatrix.log(printDuration(t0_twoClosest, "DistanceMatrix::twoClosest"));
+
+    TopTwo &best = level.front();
+    return {std::move(best[0].first), std::move(best[0].second), std::move(best[1].first), std::move(best[1].second)};
+}
@@ -0,0 +1,108 @@
+#ifndef ENCRYPTEDKMEANS_DISTANCEMATRIX_H
+#define ENCRYPTEDKMEANS_DISTANCEMATRIX_H
+
+#include "Point.h"
+#include "utils/ThreadPool.h"
+
+/**
+ * @class DistanceMatrix
+ * @brief The encrypted distances of every point from every mean, in one iteration.
+ * Keyed by point id - rows are the points, columns are the means (by index, which is also their cid).
+ * The matrix is dense and allocated up front, and filled in tiles of (points x means) by the thread pool,
+ *  so every distance is computed exactly once, and later stages query it instead of computing it again:
+ *  the closest mean of a point (\fn{closest}), and the 2 closest means (\fn{twoClosest}).
+ * */
+class DistanceMatrix {
+public:
+    /**
+     * @brief compute the distances of all the points from all the means
+     * @param points - all the points
+     * @param means - all the means (the cid of each mean is its index, see \fn{DataServer::collectMeans})
+     * @param tileSize - each task computes a tile of (tileSize points x tileSize means)
+     * @note the points and means are not copied, so they must outlive the queries.
+     * */
+    void compute(const std::vector<Point> &points,
+                 const std::vector<Point> &means,
+                 ThreadPool &threadPool,
+                 long tileSize = 4);
+
+    /**
+     * @brief the (square of the) distance of a point from a mean
+     * @return const EncryptedNum &
+     * */
+    const EncryptedNum &distance(const Point &point, long meanIndex) const {
+        return distances[rowIndex.at(point.id)][meanIndex];
+    }
+
+    /**
+     * @brief the (squares of the) distances of a point from all the means
+     * @return const std::vector<EncryptedNum> &
+     * */
+    const std::vector<EncryptedNum> &row(const Point &point) const {
+        return distances[rowIndex.at(point.id)];
+    }
+
+    /**
+     * @brief the closest mean to a point, and the distance from it (see \fn{Point::argmin})
+     * @param threadPool if given, the matches of every level of the tournament are computed in parallel
+     * @param oneHot if given, set to the one-hot assignment of the point (a bit per mean, 1 only for the closest)
+     * @return std::pair<Point, EncryptedNum>
+     * */
+    std::pair<Point, EncryptedNum>
+    closest(const Point &point, ThreadPool *threadPool = nullptr, std::vector<CBit> *oneHot = nullptr) const;
+
+    /**
+     * @brief the closest and the second closest means to a point, and the distances from them.
+     *  a tournament too, where every candidate carries its 2 best: when A meets B,
+     *  the winner is the closer of A.first, B.first, and the second is the closer of
+     *  the winner's second and the loser's first - so 2 more comparisons per match.
+     * @note there must be at least 2 means. on ties the first ones win.
+     * @return {closest, its distance, second closest, its distance}
+     * @return std::tuple<Point, EncryptedNum, Point, EncryptedNum>
+     * */
+    std::tuple<Point, EncryptedNum, Point, EncryptedNum>
+    twoClosest(const Point &point, ThreadPool *threadPool = nullptr) const;
+
+    long numOfRows() const {
+        return distances.size();
+    }
+
+    long numOfMeans() const {
+        return means.size();
+    }
+
+    bool empty() const {
+        return distances.empty();
+    }
+
+    /**
+     * @brief collect the ciphertexts of all the distances (e.g. for a \class{CapacityMonitor} checkpoint)
+     * */
+    void collectCtxts(std::vector<Ctxt *> &ctxts) {
+        for (std::vector<EncryptedNum> &distancesOfPoint: distances)
+            for (EncryptedNum &distance: distancesOfPoint)
+                for (Ctxt &bit: distance) ctxts.push_back(&bit);
+    }
+
+    void clear() {
+        means.clear();
+        rowIndex.clear();
+        distances.clear();
+        distances.shrink_to_fit();
+    }
+
+private:
+    //! the columns
+    std::vector<const Point *> means;
+
+    //! the row of each point id
+    std::unordered_map<long, long> rowIndex;
+
+    //! [row][mean index]
+    std::vector<std::vector<EncryptedNum> > distances;
+
+    void computeTile(const std::vector<Point> &points, long firstRow, long firstMean, long tileSize);
+};
+
+
+#endif //ENCRYPTEDKMEANS_DISTANCEMATRIX_H
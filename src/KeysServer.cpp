@@ -7,14 +7,24 @@
 #include "KeysServer.h"
 #include "Point.h"
 
+#include <cerrno>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
 Logger loggerKeysServer(log_debug, "loggerKeysServer");//todo change to log_trace
 
 // Validates the prm value, throwing if invalid
 // [prm] Corresponds to the number of entry in mValues table
 long KeysServer::validatePrm(long prm) {
-    //    if (prm < 0 || prm >= 5) throw std::invalid_argument("prm must be in the interval [0, 4]");
-    //todo this says which row is chosen from mValues so prm only needs to be in the range of [0, mValue.size()]
-    if (prm < 0 || prm >= 7) throw std::invalid_argument("prm must be in the interval [0, 4]");
+    //  prm says which row is chosen from mValues
+    const long rows = sizeof(mValues) / sizeof(mValues[0]);
+    if (prm < 0 || prm >= rows)
+        throw std::invalid_argument("prm must be in the interval [0, " + std::to_string(rows - 1) + "]");
     return prm;
 };
 
@@ -56,6 +66,113 @@ long KeysServer::calculateLevels(bool bootstrap, long bitSize) {
            : 30 * (7 + NTL::NumBits(bitSize + 2)); // that should be enough
 };
 
+/*
+ * Parameter planning.
+ * The depths are in multiplications of bits (levels), and are estimates of helib's binary circuits:
+ *  a comparison of b bits is a log-depth prefix of the bit equalities, and 2 more levels for the result and max/min,
+ *  an adder of b bits is a log-depth carry lookahead, and a sum of k numbers is a 3-for-2 tree
+ *  (log1.5(k) levels) followed by an adder.
+ * */
+
+//  the modulus bits of helib's thin recryption (and the ones of a level - see KeysServer::BITS_PER_LEVEL)
+static const long RECRYPTION_BITS = 600;
+
+long KeysServer::comparisonDepth(long bitSize) {
+    return NTL::NumBits(bitSize) + 2;
+}
+
+long KeysServer::adderDepth(long bitSize) {
+    return NTL::NumBits(bitSize) + 1;
+}
+
+std::vector<std::pair<std::string, long> >
+KeysServer::pipelineDepths(long numberOfPoints, long dim, long bitSize, double epsilon) {
+    const long numOfMeans = [dim, epsilon] {
+        long means = 1;
+        for (long d = 0; d < dim; ++d) means *= 1 + long(std::pow(1 / epsilon, d + 1));
+        return means;
+    }();
+    const long distanceBits = 2 * bitSize + NTL::NumBits(dim);
+    const long summandsDepth = long(std::ceil(std::log(double(dim * bitSize)) / std::log(1.5)));
+
+    std::vector<std::pair<std::string, long> > depths;
+    //  Batcher's network over the reps of the last (biggest) dim - log(m) * (log(m) + 1) / 2 layers,
+    //  each a comparison and a select
+    const long sortLayers = [dim, epsilon] {
+        const long log2Reps = NTL::NumBits(long(std::pow(1 / epsilon, dim)));
+        return log2Reps * (log2Reps + 1) / 2;
+    }();
+    depths.emplace_back("sortRandomPoints", sortLayers * (comparisonDepth(bitSize) + 1));
+    depths.emplace_back("createCmpDict", comparisonDepth(bitSize));
+    //  every dim ANDs the slice bit of the base slice and the 2 comparisons with the bracketing (sorted) reps
+    //  in a product tree, and the point is multiplied by the bit
+    depths.emplace_back("splitIntoEpsNet", comparisonDepth(bitSize) + 2 * dim + 1);
+    //  the sizes are divided by the keys server, so the means are (nearly) fresh
+    depths.emplace_back("calculateSlicesMeans",
+                        long(std::ceil(std::log(double(numberOfPoints)) / std::log(1.5)))
+                        + adderDepth(bitSize + NTL::NumBits(numberOfPoints)));
+    //  the squared-difference kernel - subtract, |.|, the partial products, and their sum
+    depths.emplace_back("distances",
+                        adderDepth(bitSize + 1) + NTL::NumBits(bitSize) + 1 + summandsDepth + adderDepth(distanceBits));
+    //  the tournament - a comparison and a select per level
+    depths.emplace_back("findMinDistFromMeans",
+                        NTL::NumBits(numOfMeans - 1) * (comparisonDepth(distanceBits) + 1));
+    //  the threshold comparison, the one-hot AND and the mask of the point
+    depths.emplace_back("choosePointsByDistance", comparisonDepth(distanceBits) + 2);
+    return depths;
+}
+
+KeysServer::FheParams KeysServer::planParams(long numberOfPoints,
+                                             long dim,
+                                             long bitSize,
+                                             double epsilon,
+                                             bool bootstrap,
+                                             long minSlots,
+                                             double minSecurity) {
+    FheParams params{};
+    params.stageDepths = pipelineDepths(numberOfPoints, dim, bitSize, epsilon);
+
+    long iterationDepth = 0, deepestStage = 0;
+    for (auto const &[stage, depth]: params.stageDepths) {
+        iterationDepth += depth;
+        deepestStage = std::max(deepestStage, depth);
+    }
+    //  w/o bootstrapping the leftover points are carried (masked) into the next iterations, so the depth adds up
+    const long iterations = std::max(1L, long(std::log2(numberOfPoints)) - 1);
+    params.depth = bootstrap ? deepestStage : iterations * iterationDepth;
+    params.L = BITS_PER_LEVEL * params.depth + (bootstrap ? RECRYPTION_BITS : BITS_PER_LEVEL);
+
+    const long rows = sizeof(mValues) / sizeof(mValues[0]);
+    const double tinyCost = mValues[0][1] * std::log2(mValues[0][1]) * 300 * (mValues[0][14] + 1);
+    for (long row = 0; row < rows; ++row) {
+        const long *vals = mValues[row];
+        if (2 != vals[0]) continue; //  binary arithmetic
+        const long phim = vals[1];
+        params.slots = phim / vals[3];
+        //  helib's (older) estimate of the security level, by the ratio of phi(m) to the modulus bits
+        params.security = 7.2 * phim / params.L - 110;
+        if (params.slots < minSlots || (0 < minSecurity && params.security < minSecurity)) continue;
+
+        params.prm = row;
+        params.c = vals[14];
+        params.ctxtKB = 2.0 * phim * params.L / 8 / 1024;
+        params.multCost = phim * std::log2(phim) * params.L * (params.c + 1) / tinyCost;
+        return params;
+    }
+    throw std::invalid_argument("no mValues row has " + std::to_string(minSlots) + " slots and a security level of "
+                                + std::to_string(minSecurity) + " with L=" + std::to_string(params.L));
+}
+
+void KeysServer::printParams(const FheParams &params) {
+    cout << " ---   FHE Parameters  ---" << endl;
+    for (auto const &[stage, depth]: params.stageDepths) cout << "   depth of " << stage << ": " << depth << endl;
+    cout << "   mValues row (prm)=" << params.prm << " L=" << params.L << " c=" << params.c
+         << " slots=" << params.slots << " depth=" << params.depth << endl;
+    cout << "   estimated security=" << params.security << " ciphertext=" << params.ctxtKB << "KB"
+         << " multiplication cost=" << params.multCost << " (x tiny)" << endl;
+    cout << " --- --- --- --- ---" << endl;
+}
+
 helib::Context &KeysServer::prepareContext(helib::Context &contxt) {
     if (VERBOSE) {
         cout << "input BIT_SIZE=" << bitSize << endl;
@@ -86,6 +203,96 @@ void KeysServer::prepareSecKey(helib::SecKey &key) const {
     if (VERBOSE) cout << " done\n";
 };
 
+std::string KeysServer::keyStorePath(long prm, long bitSize, bool bootstrap, long L) {
+    if (KEYS_DIR.empty()) return "";
+    return KEYS_DIR + "keys_prm" + std::to_string(prm)
+           + "_bits" + std::to_string(bitSize)
+           + "_L" + std::to_string(L)
+           + (bootstrap ? "_bootstrap" : "");
+}
+
+bool KeysServer::isStored(const std::string &keyStoreFile) {
+    for (const std::string &ext: {".context", ".seckey", ".unpack"})
+        if (!std::filesystem::exists(keyStoreFile + ext)) return false;
+    return true;
+}
+
+helib::Context KeysServer::loadContext(const std::string &keyStoreFile) {
+    auto t0_loadContext = CLOCK::now();
+    std::ifstream contextStream(keyStoreFile + ".context", std::ios::binary);
+    helib::Context contxt = helib::Context::readFrom(contextStream);
+    loggerKeysServer.log(printDuration(t0_loadContext, "loadContext"));
+    return contxt;
+}
+
+helib::Context &KeysServer::prepareLoadedContext(helib::Context &contxt) const {
+    //  the mod chain is part of the stored context, only the bootstrapping data may need to be rebuilt
+    if (bootstrap && !contxt.isBootstrappable()) contxt.enableBootStrapping(mvec);
+
+    std::ifstream unpackStream(keyStoreFile + ".unpack");
+    long size;
+    unpackStream >> size;
+    unpackSlotEncoding.resize(size);
+    for (helib::zzX &encoding: unpackSlotEncoding) unpackStream >> encoding;
+
+    if (VERBOSE) cout << "context loaded from " << keyStoreFile << endl;
+    return contxt;
+}
+
+helib::SecKey KeysServer::loadSecKey(const std::string &keyStoreFile, const helib::Context &contxt) {
+    auto t0_loadSecKey = CLOCK::now();
+    std::ifstream secKeyStream(keyStoreFile + ".seckey", std::ios::binary);
+    helib::SecKey key = helib::SecKey::readFrom(secKeyStream, contxt);
+    loggerKeysServer.log(printDuration(t0_loadSecKey, "loadSecKey"));
+    return key;
+}
+
+//  the secret key (with its key-switching and recryption data) - created with mode 0600,
+//  and an existing file is narrowed to it before anything is written
+static void writeOwnerOnly(const std::string &filename, const std::function<void(std::ostream &)> &writeTo) {
+    std::ostringstream buffer(std::ios::binary);
+    writeTo(buffer);
+    const std::string data = buffer.str();
+
+    const int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (-1 == fd) throw std::runtime_error("storeKeys: can't create " + filename);
+    if (-1 == fchmod(fd, S_IRUSR | S_IWUSR)) {
+        close(fd);
+        throw std::runtime_error("storeKeys: can't restrict the permissions of " + filename);
+    }
+    for (size_t written = 0; written < data.size();) {
+        const ssize_t n = write(fd, data.data() + written, data.size() - written);
+        if (n <= 0) {
+            if (-1 == n && EINTR == errno) continue;
+            close(fd);
+            throw std::runtime_error("storeKeys: can't write " + filename);
+        }
+        written += n;
+    }
+    close(fd);
+}
+
+void KeysServer::storeKeys(const std::string &keyStoreFile) const {
+    auto t0_storeKeys = CLOCK::now();
+    //  only the owner may look into a directory of secret keys (one that already exists is left as it is)
+    const std::filesystem::path dir = std::filesystem::path(keyStoreFile).parent_path();
+    if (!dir.empty() && !std::filesystem::exists(dir)) {
+        std::filesystem::create_directories(dir);
+        std::filesystem::permissions(dir, std::filesystem::perms::owner_all, std::filesystem::perm_options::replace);
+    }
+
+    //  the .unpack file is written last, so a store that was cut off before it is not loaded (see isStored)
+    std::ofstream contextStream(keyStoreFile + ".context", std::ios::binary);
+    context.writeTo(contextStream);
+    contextStream.close();
+    writeOwnerOnly(keyStoreFile + ".seckey", [this](std::ostream &stream) { secKey.writeTo(stream); });
+    std::ofstream unpackStream(keyStoreFile + ".unpack");
+    unpackStream << unpackSlotEncoding.size() << endl;
+    for (const helib::zzX &encoding: unpackSlotEncoding) unpackStream << encoding << endl;
+
+    loggerKeysServer.log(printDuration(t0_storeKeys, "storeKeys"));
+}
+
 std::vector<helib::zzX> KeysServer::unpackSlotEncoding; //todo move? already defined in class - check what a 2nd def does
 
 //! KeysServer c'tor: default values
@@ -209,6 +416,62 @@ long KeysServer::decryptNum(const EncryptedNum &cNum) const {
 #endif
 }
 
+std::vector<long> KeysServer::decryptNumSlots(const EncryptedNum &cNum) const {
+    std::vector<long> pNums;
+    if (cNum.empty()) return pNums;
+    EncryptedNum vector = cNum;
+    helib::decryptBinaryNums(pNums,
+                             helib::CtPtrs_vectorCt(vector),
+                             secKey,
+                             getEA(),
+                             false,
+                             true);
+    return pNums;
+}
+
+long KeysServer::decryptBinaryNum(const EncryptedNum &cNum) const {
+    if (cNum.empty()) return -1;
+    //  decryptBinaryNums can't handle empty bits - those are decrypted bit by bit
+    for (const Ctxt &bit: cNum) if (bit.isEmpty()) return decryptNum(cNum);
+    std::vector<long> pNums;
+    //  the wrapper takes a non-const vector, but decryptBinaryNums only reads it (so no copy of the number is needed)
+    helib::decryptBinaryNums(pNums,
+                             helib::CtPtrs_vectorCt(const_cast<EncryptedNum &>(cNum)),
+                             secKey,
+                             getEA(),
+                             false,
+                             true);
+    return pNums.front();
+}
+
+std::vector<long> KeysServer::decryptNums(const std::vector<EncryptedNum> &cNums) const {
+    std::vector<std::future<long> > futures;
+    futures.reserve(cNums.size());
+    for (const EncryptedNum &cNum: cNums)
+        futures.push_back(decryptionPool.submit(&KeysServer::decryptBinaryNum, this, std::cref(cNum)));
+
+    std::vector<long> pNums;
+    pNums.reserve(cNums.size());
+    for (std::future<long> &future: futures) pNums.push_back(decryptionPool.wait(future));
+    return pNums;
+}
+
+std::vector<DecryptedPoint> KeysServer::decryptPoints(const std::vector<Point> &points) const {
+    std::vector<std::future<DecryptedPoint> > futures;
+    futures.reserve(points.size());
+    for (const Point &point: points)
+        futures.push_back(decryptionPool.submit([this, &point]() {
+            DecryptedPoint pPoint(DIM);
+            for (short dim = 0; dim < DIM; ++dim) pPoint[dim] = decryptBinaryNum(point[dim]);
+            return pPoint;
+        }));
+
+    std::vector<DecryptedPoint> pPoints;
+    pPoints.reserve(points.size());
+    for (std::future<DecryptedPoint> &future: futures) pPoints.push_back(decryptionPool.wait(future));
+    return pPoints;
+}
+
 long KeysServer::decryptSize(const std::vector<CBit> &cSize) const {
     long size = 0;
     NTL::ZZX pp;
@@ -250,17 +513,39 @@ KeysServer::getQuotientPoint(
     long size = decryptSize(sizeBitVector), arr[DIM];
     printNameVal(size);
     //    if (size)
-    long pCoor;
+    const std::vector<long> pCoordinates = decryptNums(point.cCoordinates);
     for (short dim = 0; dim < DIM; ++dim) {
-        pCoor = decryptNum(point[dim]);
-        arr[dim] = decryptNum(point[dim]) / (repsNum + size);
-//        printNameVal(pCoor);
+        arr[dim] = pCoordinates[dim] / (repsNum + size);
 //        printNameVal(arr[dim]);
     }
 
     return Point(point.public_key, arr);
 }
 
+std::vector<Point>
+KeysServer::getQuotientPoints(
+        const std::vector<Point> &points,
+        const std::vector<const std::vector<CBit> *> &sizeBitVectors,
+        const short repsNum) const {
+    auto t0_quotients = CLOCK::now();
+
+    std::vector<std::future<Point> > futures;
+    futures.reserve(points.size());
+    for (long i = 0; i < points.size(); ++i)
+        futures.push_back(decryptionPool.submit([this, &point = points[i], &sizeBitVector = *sizeBitVectors[i], repsNum]() {
+            long size = decryptSize(sizeBitVector), arr[DIM];
+            for (short dim = 0; dim < DIM; ++dim) arr[dim] = decryptBinaryNum(point[dim]) / (repsNum + size);
+            return Point(point.public_key, arr);
+        }));
+
+    std::vector<Point> quotients;
+    quotients.reserve(points.size());
+    for (std::future<Point> &future: futures) quotients.push_back(decryptionPool.wait(future));
+
+    loggerKeysServer.log(printDuration(t0_quotients, "getQuotientPoints"));
+    return quotients;
+}
+
 const EncryptedNum
 KeysServer::getQuotient(
         const EncryptedNum &encryptedNum,
@@ -282,5 +567,28 @@ KeysServer::getQuotient(
     return cQuotient;
 }
 
+std::vector<Ctxt> KeysServer::refreshCtxts(const std::vector<Ctxt> &ctxts) const {
+    auto t0_refresh = CLOCK::now();
+
+    std::vector<std::future<Ctxt> > futures;
+    futures.reserve(ctxts.size());
+    for (const Ctxt &ctxt: ctxts)
+        futures.push_back(decryptionPool.submit([this, &ctxt]() {
+            Ctxt fresh(ctxt.getPubKey());
+            if (ctxt.isEmpty()) return fresh;
+            NTL::ZZX poly;
+            secKey.Decrypt(poly, ctxt);
+            ctxt.getPubKey().Encrypt(fresh, poly);
+            return fresh;
+        }));
+
+    std::vector<Ctxt> refreshed;
+    refreshed.reserve(ctxts.size());
+    for (std::future<Ctxt> &future: futures) refreshed.push_back(decryptionPool.wait(future));
+
+    loggerKeysServer.log(printDuration(t0_refresh, "refreshCtxts"));
+    return refreshed;
+}
+
 
 
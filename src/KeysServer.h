@@ -8,6 +8,9 @@
 #define ENCKMEAN_KEYSSERVER_H
 
 #include "utils/aux.h"
+#include "utils/ThreadPool.h"
+
+extern Logger loggerKeysServer;     //  defined in KeysServer.cpp
 
 /**
  * @class KeysServer
@@ -17,6 +20,51 @@
  * */
 class KeysServer {
 public:
+    /**
+     * @brief the parameters chosen by \fn{planParams}, and what they are estimated to cost
+     * */
+    struct FheParams {
+        long prm;               //  the chosen row of mValues
+        long L;                 //  bits of the modulus chain
+        long c;                 //  columns of the key-switching matrices
+        long slots;             //  phi(m) / d
+        long depth;             //  the multiplicative depth L has to cover (the deepest stage, if bootstrapping -
+                                //  every stage ends at a \class{CapacityMonitor} checkpoint, see DataServer)
+        double security;        //  estimated security level (bits)
+        double ctxtKB;          //  size of a ciphertext
+        double multCost;        //  relative cost of a multiplication (the tiny row with L=300 is 1)
+        std::vector<std::pair<std::string, long> > stageDepths;  //  the depth of every stage of the pipeline
+    };
+
+    //! a prm that tells the c'tor to choose the parameters by \fn{planParams}
+    static constexpr long AUTO_PRM = -1;
+
+    //! the modulus bits (capacity) that a level consumes, in the planning of L
+    static constexpr long BITS_PER_LEVEL = 30;
+
+    /**
+     * @brief choose the cheapest mValues row, L and c for the pipeline:
+     *  estimate the multiplicative depth of each stage (comparisons, the eps-net split, distances,
+     *  the closest-mean tournament and the grouping) from the data properties,
+     *  then L covers the deepest stage (if bootstrapping - the \class{CapacityMonitor} recrypts between the stages:
+     *  the DataServer has a checkpoint at the end of every one of them, so no 2 stages run back to back)
+     *  or all the iterations (if not), and the first (smallest) row with p = 2 (binary arithmetic),
+     *  with enough slots and the required security level, is chosen.
+     * @param minSlots the slots needed (e.g. the number of points in a \class{PointBatch})
+     * @param minSecurity the required security level (bits). 0 - any (toy parameters, for development)
+     * @throws std::invalid_argument if no row satisfies them
+     * @return FheParams
+     * */
+    static FheParams planParams(long numberOfPoints = NUMBER_OF_POINTS,
+                                long dim = DIM,
+                                long bitSize = BIT_SIZE,
+                                double epsilon = EPSILON,
+                                bool bootstrap = true,
+                                long minSlots = 1,
+                                double minSecurity = MIN_SECURITY_LEVEL);
+
+    static void printParams(const FheParams &params);
+
     static std::vector<helib::zzX> unpackSlotEncoding;
     helib::PubKey &public_key;
     //    helib::PubKey &pubKeyRef;
@@ -64,6 +112,7 @@ protected:
             {127, 72000, 77531, 30, 61,  1271, 0,   7627,  34344, 0,     60,  40,  0,   100}  // m=(31)*{41}*61 m/phim(m)=1.07   C=128 D=2
     };
 
+    const FheParams params; //  the planned parameters (used if the c'tor was given #AUTO_PRM)
     const long prm; // parameter size (0-tiny,...,4-huge) //todo this says which row is chosen from mValues
     const long bitSize; // itSize of input integers (<=32)
     const bool bootstrap; // comparison with bootstrapping (??)
@@ -77,14 +126,17 @@ protected:
     const std::vector<long> ords;
     const long c;
     const long L;
+    const std::string keyStoreFile; //  path prefix of the stored context & keys (empty - no key store)
+    const bool isKeyStored;         //  load the context & keys instead of generating them
     helib::Context context;
     helib::SecKey secKey; //private? //reference?
     helib::SecKey &secKeyRef; //private? //reference?
+    mutable ThreadPool decryptionPool;  //  for the batch decryptions (see \fn decryptNums)
 
 public:
 
     explicit KeysServer(
-            long prm = 0, // parameter size (0-tiny,...,4-huge) //  CT bigger is slower...
+            long prm = AUTO_PRM, // parameter size (0-tiny,...,4-huge) //  CT bigger is slower... (#AUTO_PRM - planned)
             long bitSize = BIT_SIZE, // bitSize of input integers (<=32)
             bool bootstrap = true, // comparison with bootstrapping
             // (KT-26.oct.21) definitely make bootstrap true - for cmp w/ min/max (and for huge number of points(?))
@@ -92,21 +144,29 @@ public:
             long nthreads = N_Threads // number of threads
     )
             :
-            prm(validatePrm(prm)),//todo this says which row is chosen from mValues
+            //  planned only when asked to - an explicit prm must not depend on (or fail by) the planning
+            params(AUTO_PRM == prm
+                   ? planParams(NUMBER_OF_POINTS, DIM, correctBitSize(5, bitSize), EPSILON, bootstrap)
+                   : FheParams{}),
+            prm(AUTO_PRM == prm ? params.prm : validatePrm(prm)),//todo this says which row is chosen from mValues
             bitSize(correctBitSize(5, bitSize)),
             bootstrap(bootstrap),
             // (KT-26.oct.21) definitely make bootstrap true - for cmp w/ min/max (and for huge number of points(?))
             seed(seed),
             nthreads(nthreads),
-            vals(mValues[prm]),   //todo this is initialized w/ the row #prm chosen from mValues
+            vals(mValues[this->prm]),   //todo this is initialized w/ the row #prm chosen from mValues
             p(vals[0]),
             m(vals[2]),
             mvec(calculateMvec(vals)),
             gens(calculateGens(vals)),
             ords(calculateOrds(vals)),
-            c(vals[14]),
-            L(calculateLevels(bootstrap, bitSize)),
-            context(helib::ContextBuilder<helib::BGV>()
+            c(AUTO_PRM == prm ? params.c : vals[14]),
+            L(AUTO_PRM == prm ? params.L : calculateLevels(bootstrap, bitSize)),
+            keyStoreFile(keyStorePath(this->prm, this->bitSize, bootstrap, L)),
+            isKeyStored(!keyStoreFile.empty() && isStored(keyStoreFile)),
+            context(isKeyStored
+                    ? loadContext(keyStoreFile)
+                    : helib::ContextBuilder<helib::BGV>()
                             .m(m)
                             .p(p)
                             .r(1)
@@ -114,7 +174,9 @@ public:
                             .ords(ords)
                             .buildModChain(false)
                             .build()),
-            secKey(prepareContext(context)),
+            secKey(isKeyStored
+                   ? loadSecKey(keyStoreFile, prepareLoadedContext(context))
+                   : helib::SecKey(prepareContext(context))),
             secKeyRef(secKey),
             // In HElib, the SecKey class is actually a subclass if the PubKey class.  So
             // one way to initialize a public key object is like this:
@@ -125,13 +187,22 @@ public:
             // encryptions done via publicKey will actually use the secret key, which has
             // certain advantages. If one left out the "&", then encryptions done via
             // publicKey will NOT use the secret key.
-            public_key(secKey)
+            public_key(secKey),
+            decryptionPool(nthreads)
             {
 
+        if (VERBOSE && AUTO_PRM == prm) printParams(params);
         if (seed) NTL::SetSeed(NTL::ZZ(seed));
+        //  the seed only reaches the encryptions then - the keys are the stored ones, whatever the seed
+        if (seed && isKeyStored)
+            loggerKeysServer.log("KeysServer: the keys were loaded from " + keyStoreFile
+                                 + ", so they were not generated from seed " + std::to_string(seed));
         if (nthreads > 1) NTL::SetNumThreads(nthreads);
 
-        prepareSecKey(secKey);
+        if (!isKeyStored) {
+            prepareSecKey(secKey);
+            if (!keyStoreFile.empty()) storeKeys(keyStoreFile);
+        }
 
         helib::activeContext = &context; // make things a little easier sometimes
 
@@ -150,6 +221,16 @@ public:
         //        return deserialized_pkp;
     }
 
+    //! the planned parameters (empty - the c'tor was given a prm)
+    const FheParams &getParams() const {
+        return params;
+    }
+
+    //! the context & keys were loaded from the key store (under #KEYS_DIR), instead of generated
+    bool areKeysLoaded() const {
+        return isKeyStored;
+    }
+
     /* * *  for DBG    * * */
     helib::Ctxt encryptCtxt(bool b) const {
         NTL::ZZX pl(b);
@@ -173,6 +254,13 @@ public:
 
     long decryptSize(const std::vector<helib::Ctxt> &size) const;
 
+    /**
+     * @brief decrypt a packed (SIMD) number - a different number in every slot
+     * @returns the number held in each slot
+     * @return std::vector<long>
+     * */
+    std::vector<long> decryptNumSlots(const EncryptedNum &cNum) const;
+
     const helib::Context &getContextDBG() const {
         return getContext();
     }
@@ -216,10 +304,39 @@ private:
 
     static long calculateLevels(bool bootstrap, long bitSize);
 
+    //  the depth estimates of \fn{planParams}
+    static long comparisonDepth(long bitSize);
+
+    static long adderDepth(long bitSize);
+
+    static std::vector<std::pair<std::string, long> >
+    pipelineDepths(long numberOfPoints, long dim, long bitSize, double epsilon);
+
     helib::Context &prepareContext(helib::Context &contxt);
 
+    //  all the bits of the number are decrypted at once (the first slot is returned)
+    long decryptBinaryNum(const EncryptedNum &cNum) const;
+
     void prepareSecKey(helib::SecKey &key) const;
 
+    /*
+     * Key store - the context, the secret key (with its key-switching matrices & recryption data)
+     * and the unpackSlotEncoding are written once, under #KEYS_DIR,
+     * and loaded by every later KeysServer with the same mValues row, bitSize, bootstrap flag and L.
+     * */
+    static std::string keyStorePath(long prm, long bitSize, bool bootstrap, long L);
+
+    static bool isStored(const std::string &keyStoreFile);
+
+    static helib::Context loadContext(const std::string &keyStoreFile);
+
+    static helib::SecKey loadSecKey(const std::string &keyStoreFile, const helib::Context &contxt);
+
+    //  the loaded counterpart of prepareContext
+    helib::Context &prepareLoadedContext(helib::Context &contxt) const;
+
+    void storeKeys(const std::string &keyStoreFile) const;
+
 public:
     /*  services    */ //todo consider moving back to DataServer
     /**
@@ -238,7 +355,45 @@ public:
     const Point getQuotientPoint(const Point &point, const std::vector<Ctxt> &sizeBitVector,
                                  const short repsNum) const;
 
+    /**
+     * @brief the batched \fn getQuotientPoint - all the slices in one call to the keys server.
+     * each (sum, size) is a task on the decryption pool - decrypted, divided and encrypted again,
+     * so the means are not gated on one-by-one calls.
+     * @param points the sums (of the points of each slice)
+     * @param sizeBitVectors the isIncluded bits of each slice (their sum is its size)
+     * @returns the quotients, in the same order
+     * @return std::vector<Point>
+     * */
+    std::vector<Point> getQuotientPoints(const std::vector<Point> &points,
+                                         const std::vector<const std::vector<Ctxt> *> &sizeBitVectors,
+                                         short repsNum) const;
+
     const EncryptedNum getQuotient(const EncryptedNum &encryptedNum, const long num) const;
+
+    /**
+     * @brief refresh ciphertexts - decrypt each one (all of its slots) and encrypt it again, with fresh noise.
+     * the keys server's alternative to recryption (e.g. when the keys are not bootstrappable).
+     * each ciphertext is a task on the decryption pool
+     * @returns the fresh ciphertexts, in the same order
+     * @return std::vector<Ctxt>
+     * */
+    std::vector<Ctxt> refreshCtxts(const std::vector<Ctxt> &ctxts) const;
+
+    /**
+     * @brief decrypt many numbers at once.
+     * each number is a task on the decryption pool, and all of its bits are decrypted together
+     * with helib::decryptBinaryNums (instead of a \fn decryptCtxt per bit)
+     * @returns the decrypted numbers, in the same order (-1 for an empty number, as \fn decryptNum)
+     * @return std::vector<long>
+     * */
+    std::vector<long> decryptNums(const std::vector<EncryptedNum> &cNums) const;
+
+    /**
+     * @brief decrypt many points at once, a task per point.
+     * @returns the decrypted points, in the same order
+     * @return std::vector<DecryptedPoint>
+     * */
+    std::vector<DecryptedPoint> decryptPoints(const std::vector<Point> &points) const;
 };
 
 
@@ -0,0 +1,267 @@
+#include "KeysServerChannel.h"
+
+#include <cerrno>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static Logger loggerKeysServerChannel(log_debug, "loggerKeysServerChannel");
+
+KeysServerChannel::KeysServerChannel(const KeysServer &keysServer, Transport transport) :
+        keysServer(keysServer),
+        transport(transport) {
+    if (Transport::SOCKET == transport) {
+        if (-1 == socketpair(AF_UNIX, SOCK_STREAM, 0, sockets))
+            throw std::runtime_error("KeysServerChannel: can't open a socket pair");
+        server = std::thread(&KeysServerChannel::serveSocket, this);
+        responsesReader = std::thread(&KeysServerChannel::readResponses, this);
+    } else
+        server = std::thread(&KeysServerChannel::serveQueue, this);
+}
+
+KeysServerChannel::~KeysServerChannel() {
+    if (Transport::SOCKET == transport) {
+        //  the keys server reads the rest of the requests, then closes its end - and so the reader stops too
+        shutdown(sockets[0], SHUT_WR);
+        server.join();
+        responsesReader.join();
+        close(sockets[0]);
+        close(sockets[1]);
+    } else {
+        {
+            std::unique_lock<std::mutex> lock(requestsLock);
+            stopping = true;
+        }
+        requestsCondition.notify_all();
+        server.join();
+    }
+}
+
+template<typename T>
+std::future<T> KeysServerChannel::send(Message &&request, std::function<T(Message &&)> decode) {
+    //  shared - a Reply is copyable (std::function), a promise is not
+    auto promise = std::make_shared<std::promise<T> >();
+    std::future<T> future = promise->get_future();
+    Reply reply{
+            [promise, decode = std::move(decode)](Message &&response) {
+                try {
+                    promise->set_value(decode(std::move(response)));
+                } catch (...) {
+                    promise->set_exception(std::current_exception());
+                }
+            },
+            [promise](std::exception_ptr error) { promise->set_exception(error); }
+    };
+    if (Transport::SOCKET == transport) {
+        const std::string frame = serialize(request);
+        std::lock_guard<std::mutex> lock(pendingLock);
+        pending.push_back(std::move(reply));
+        writeFrame(sockets[0], frame);
+    } else {
+        {
+            std::lock_guard<std::mutex> lock(requestsLock);
+            requests.emplace_back(std::move(request), std::move(reply));
+        }
+        requestsCondition.notify_one();
+    }
+    return future;
+}
+
+std::future<std::vector<Point> >
+KeysServerChannel::getQuotientPoints(const std::vector<Point> &sums,
+                                     const std::vector<const std::vector<Ctxt> *> &sizeBitVectors,
+                                     short repsNum) {
+    //  every sum is DIM groups (its coordinates), followed by the size bits of its slice
+    Message request{QUOTIENT_POINTS, repsNum, {}};
+    request.groups.reserve(sums.size() * (DIM + 1));
+    for (long i = 0; i < sums.size(); ++i) {
+        for (short dim = 0; dim < DIM; ++dim) request.groups.push_back(sums[i][dim]);
+        request.groups.push_back(*sizeBitVectors[i]);
+    }
+
+    return send<std::vector<Point> >(std::move(request), [](Message &&quotients) {
+        std::vector<Point> points;
+        points.reserve(quotients.groups.size() / DIM);
+        for (auto it = quotients.groups.begin(); it != quotients.groups.end(); it += DIM)
+            points.emplace_back(std::vector<EncryptedNum>(std::make_move_iterator(it),
+                                                          std::make_move_iterator(it + DIM)),
+                                counter++);
+        return points;
+    });
+}
+
+std::future<EncryptedNum> KeysServerChannel::getQuotient(const EncryptedNum &encryptedNum, long num) {
+    return send<EncryptedNum>(Message{QUOTIENT, num, {encryptedNum}}, [](Message &&response) {
+        return std::move(response.groups.front());
+    });
+}
+
+std::future<std::vector<Ctxt> > KeysServerChannel::refresh(const std::vector<Ctxt> &ctxts) {
+    return send<std::vector<Ctxt> >(Message{REFRESH, 0, {ctxts}}, [](Message &&response) {
+        return std::move(response.groups.front());
+    });
+}
+
+KeysServerChannel::Message KeysServerChannel::handle(const Message &request) const {
+    auto t0_handle = CLOCK::now();
+    Message response{request.type, 0, {}};
+
+    switch (request.type) {
+        case QUOTIENT_POINTS: {
+            std::vector<Point> sums;
+            std::vector<const std::vector<Ctxt> *> sizeBitVectors;
+            for (auto it = request.groups.begin(); it != request.groups.end(); it += DIM + 1) {
+                sums.emplace_back(std::vector<EncryptedNum>(it, it + DIM), -1);
+                sizeBitVectors.push_back(&*(it + DIM));
+            }
+            std::vector<Point> quotients = keysServer.getQuotientPoints(sums, sizeBitVectors, short(request.num));
+            response.groups.reserve(quotients.size() * DIM);
+            for (Point &quotient: quotients)
+                for (EncryptedNum &coordinate: quotient.cCoordinates) response.groups.push_back(std::move(coordinate));
+            break;
+        }
+        case QUOTIENT:
+            response.groups.push_back(keysServer.getQuotient(request.groups.front(), request.num));
+            break;
+        case REFRESH:
+            response.groups.push_back(keysServer.refreshCtxts(request.groups.front()));
+            break;
+        default:
+            throw std::invalid_argument("KeysServerChannel: unknown request " + std::to_string(request.type));
+    }
+
+    loggerKeysServerChannel.log(printDuration(t0_handle, "handle " + std::to_string(request.type)));
+    return response;
+}
+
+void KeysServerChannel::serveQueue() {
+    while (true) {
+        std::unique_lock<std::mutex> lock(requestsLock);
+        requestsCondition.wait(lock, [this] { return stopping || !requests.empty(); });
+        if (requests.empty()) return;   //  stopping, and nothing is left
+        std::pair<Message, Reply> request = std::move(requests.front());
+        requests.pop_front();
+        lock.unlock();
+
+        Message response{ERROR, 0, {}};
+        try {
+            response = handle(request.first);
+        } catch (...) {
+            request.second.fail(std::current_exception());
+            continue;
+        }
+        request.second.deliver(std::move(response));
+    }
+}
+
+void KeysServerChannel::serveSocket() {
+    std::string frame;
+    while (readFrame(sockets[1], frame)) {
+        Message response{ERROR, 0, {}};
+        try {
+            response = handle(deserialize(frame, keysServer.getPublicKey()));
+        } catch (const std::exception &e) {
+            loggerKeysServerChannel.log(std::string("serveSocket: ") + e.what());
+            response = Message{ERROR, 0, {}};
+        }
+        writeFrame(sockets[1], serialize(response));
+    }
+    shutdown(sockets[1], SHUT_WR);
+}
+
+void KeysServerChannel::readResponses() {
+    std::string frame;
+    while (readFrame(sockets[0], frame)) {
+        Message response = deserialize(frame, keysServer.getPublicKey());
+        Reply reply;
+        {
+            std::lock_guard<std::mutex> lock(pendingLock);
+            reply = std::move(pending.front());
+            pending.pop_front();
+        }
+        //  decoded here, on the reader's thread - the caller's future is ready as soon as this returns
+        if (ERROR == response.type)
+            reply.fail(std::make_exception_ptr(
+                    std::runtime_error("KeysServerChannel: the keys server failed to handle a request")));
+        else reply.deliver(std::move(response));
+    }
+
+    std::lock_guard<std::mutex> lock(pendingLock);
+    for (Reply &reply: pending)
+        reply.fail(std::make_exception_ptr(std::runtime_error("KeysServerChannel: closed")));
+    pending.clear();
+}
+
+static void writeLong(std::ostream &stream, int64_t num) {
+    stream.write(reinterpret_cast<const char *>(&num), sizeof(num));
+}
+
+static int64_t readLong(std::istream &stream) {
+    int64_t num = 0;
+    stream.read(reinterpret_cast<char *>(&num), sizeof(num));
+    return num;
+}
+
+std::string KeysServerChannel::serialize(const Message &message) {
+    std::ostringstream stream(std::ios::binary);
+    writeLong(stream, message.type);
+    writeLong(stream, message.num);
+    writeLong(stream, message.groups.size());
+    for (const std::vector<Ctxt> &group: message.groups) {
+        writeLong(stream, group.size());
+        for (const Ctxt &ctxt: group) ctxt.writeTo(stream);
+    }
+    return stream.str();
+}
+
+KeysServerChannel::Message KeysServerChannel::deserialize(const std::string &frame, const helib::PubKey &public_key) {
+    std::istringstream stream(frame, std::ios::binary);
+    Message message{readLong(stream), readLong(stream), {}};
+    message.groups.resize(readLong(stream));
+    for (std::vector<Ctxt> &group: message.groups) {
+        group.assign(readLong(stream), Ctxt(public_key));
+        for (Ctxt &ctxt: group) ctxt.read(stream);
+    }
+    if (!stream) throw std::runtime_error("KeysServerChannel: a truncated message");
+    return message;
+}
+
+//  MSG_NOSIGNAL - a closed peer is an error, not a SIGPIPE
+static void sendAll(int fd, const char *data, size_t size) {
+    while (size) {
+        const ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            if (-1 == sent && EINTR == errno) continue;
+            throw std::runtime_error("KeysServerChannel: can't write to the socket");
+        }
+        data += sent;
+        size -= sent;
+    }
+}
+
+//  false if the peer closed before all of it was read
+static bool recvAll(int fd, char *data, size_t size) {
+    while (size) {
+        const ssize_t received = ::recv(fd, data, size, 0);
+        if (received <= 0) {
+            if (-1 == received && EINTR == errno) continue;
+            return false;
+        }
+        data += received;
+        size -= received;
+    }
+    return true;
+}
+
+void KeysServerChannel::writeFrame(int fd, const std::string &frame) {
+    const uint64_t size = frame.size();
+    sendAll(fd, reinterpret_cast<const char *>(&size), sizeof(size));
+    sendAll(fd, frame.data(), frame.size());
+}
+
+bool KeysServerChannel::readFrame(int fd, std::string &frame) {
+    uint64_t size = 0;
+    if (!recvAll(fd, reinterpret_cast<char *>(&size), sizeof(size))) return false;
+    frame.resize(size);
+    return recvAll(fd, frame.data(), size);
+}
@@ -0,0 +1,132 @@
+#ifndef ENCRYPTEDKMEANS_KEYSSERVERCHANNEL_H
+#define ENCRYPTEDKMEANS_KEYSSERVERCHANNEL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <thread>
+
+#include "Point.h"
+
+/**
+ * @class KeysServerChannel
+ * @brief The message-based interface from the DataServer to the KeysServer.
+ * Every call sends one (batched) request and returns a future right away, so the DataServer can go on
+ *  with its stage while the keys server works. The keys server side serves the requests in order, on its own thread
+ *  (and spreads each one over its decryption pool).
+ * @note the futures are not deferred - the response is decoded, and the future made ready, by the thread that
+ *  receives it (the server thread, or the responses reader). so polling them (as \fn{ThreadPool::wait} does) works.
+ * Two transports:
+ *  IN_PROCESS - the requests are moved through a queue.
+ *  SOCKET - a stand-in for a remote keys server: the requests and responses are serialized
+ *      (every ciphertext with helib::Ctxt::writeTo) and go through a local (unix) socket pair.
+ * */
+class KeysServerChannel {
+public:
+    enum class Transport {
+        IN_PROCESS, SOCKET
+    };
+
+    static Transport parseTransport(const std::string &name) {
+        return "socket" == name ? Transport::SOCKET : Transport::IN_PROCESS;
+    }
+
+    explicit KeysServerChannel(const KeysServer &keysServer,
+                               Transport transport = parseTransport(KEYS_SERVER_CHANNEL));
+
+    /**
+     * @brief stop serving - the requests that were already sent are served first
+     * */
+    ~KeysServerChannel();
+
+    KeysServerChannel(const KeysServerChannel &) = delete;
+
+    KeysServerChannel &operator=(const KeysServerChannel &) = delete;
+
+    /**
+     * @brief divide N encrypted sums by the sizes of their slices (see \fn{KeysServer::getQuotientPoints})
+     * @note the sums and the size bits are copied into the request, so they don't have to outlive the call
+     * @return std::future<std::vector<Point> >
+     * */
+    std::future<std::vector<Point> >
+    getQuotientPoints(const std::vector<Point> &sums,
+                      const std::vector<const std::vector<Ctxt> *> &sizeBitVectors,
+                      short repsNum);
+
+    /**
+     * @brief divide an encrypted number by a known one (see \fn{KeysServer::getQuotient})
+     * @return std::future<EncryptedNum>
+     * */
+    std::future<EncryptedNum> getQuotient(const EncryptedNum &encryptedNum, long num);
+
+    /**
+     * @brief refresh M ciphertexts - the keys server decrypts them and encrypts them again
+     *  (fresh noise, all the slots are kept. see \fn{KeysServer::refreshCtxts})
+     * @return std::future<std::vector<Ctxt> >
+     * */
+    std::future<std::vector<Ctxt> > refresh(const std::vector<Ctxt> &ctxts);
+
+    Transport getTransport() const {
+        return transport;
+    }
+
+private:
+    //  a request or a response: a type, a number (a divisor, or the number of reps) and groups of ciphertexts
+    struct Message {
+        int64_t type;
+        int64_t num;
+        std::vector<std::vector<Ctxt> > groups;
+    };
+
+    enum MessageType : int64_t {
+        ERROR = -1, QUOTIENT_POINTS = 1, QUOTIENT = 2, REFRESH = 3
+    };
+
+    //  the caller's side of a request - decodes the response into the typed promise of the caller, or fails it
+    struct Reply {
+        std::function<void(Message &&)> deliver;
+        std::function<void(std::exception_ptr)> fail;
+    };
+
+    const KeysServer &keysServer;
+    const Transport transport;
+
+    //  IN_PROCESS - the queue of the requests, each with the reply to its response
+    std::deque<std::pair<Message, Reply> > requests;
+    std::mutex requestsLock;
+    std::condition_variable requestsCondition;
+    bool stopping = false;
+
+    //  SOCKET - [0] is the DataServer's end, [1] is the KeysServer's. the responses come back in the order of the requests
+    int sockets[2] = {-1, -1};
+    std::deque<Reply> pending;
+    std::mutex pendingLock;     //  also keeps the frames of concurrent requests from interleaving
+    std::thread responsesReader;
+
+    std::thread server;
+
+    template<typename T>
+    std::future<T> send(Message &&request, std::function<T(Message &&)> decode);
+
+    //  the keys server side
+    Message handle(const Message &request) const;
+
+    void serveQueue();
+
+    void serveSocket();
+
+    void readResponses();
+
+    //  length-prefixed frames of serialized messages
+    static std::string serialize(const Message &message);
+
+    static Message deserialize(const std::string &frame, const helib::PubKey &public_key);
+
+    static void writeFrame(int fd, const std::string &frame);
+
+    static bool readFrame(int fd, std::string &frame);
+};
+
+
+#endif //ENCRYPTEDKMEANS_KEYSSERVERCHANNEL_H
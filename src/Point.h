@@ -2,6 +2,8 @@
 #ifndef ENCRYPTEDKMEANS_POINT_H
 #define ENCRYPTEDKMEANS_POINT_H
 
+#include <atomic>
+#include <memory>
 #include <iostream>
 #include <helib/helib.h>
 #include <helib/binaryCompare.h>
@@ -9,11 +11,22 @@
 #include <NTL/ZZX.h>
 
 #include "utils/aux.h" // for including KeysServer.h
+#include "utils/ThreadPool.h"
 #include "KeysServer.h"
+#include "CtxtPool.h"
 
 static Logger loggerPoint(log_debug, "loggerPoint");
 
-static long counter = 0; //fixme move to the cpp file
+/**
+ * @brief the circuits that compute the (square of the) distance between two encrypted points
+ *  CMP - |c1 - c2| = max - min, using helib's compareTwoNumbers, then a full multiplication per dim
+ *  SQUARED_DIFF - |c1 - c2| from a 2's complement subtraction (no comparison),
+ *      then a squaring that uses only half of the partial products, summed over all dims at once
+ * */
+enum class DistanceKernel { CMP, SQUARED_DIFF };
+
+//  shared by all translation units (a `static` here gave each one its own counter, and so colliding ids)
+inline std::atomic<long> counter(0);
 
 class Point {
     friend class Client;
@@ -59,9 +72,7 @@ public:
             pubKeyPtrDBG(&public_key),
             cCoordinates(DIM, std::vector(BIT_SIZE, helib::Ctxt(public_key))) {
         originalPointAddress = this;
-        for (long bit = 0; bit < cid.size(); ++bit)
-            this->public_key.Encrypt(cid[bit],
-                                     NTL::to_ZZX((id >> bit) & 1));
+        setCid(0);
         pCoordinatesDBG.reserve(DIM);
         //        cout << " Point Init" << endl;
         if (coordinates) {
@@ -89,10 +100,17 @@ public:
     }
 
     explicit Point(const std::vector<EncryptedNum> &cCoordinates) :
+            Point(cCoordinates, counter++) {}
+
+    /**
+     * @brief a point built from already encrypted coordinates, keeping a given id
+     * (e.g. a point unpacked from a \class{PointBatch} keeps the id it was packed with)
+     * */
+    Point(const std::vector<EncryptedNum> &cCoordinates, long id) :
             //todo maybe better to init to 0, depending future impl & use
             cmpCounter(0), addCounter(0), multCounter(0),
             public_key(cCoordinates[0][0].getPubKey()),
-            id(counter++),
+            id(id),
             cid(CID_BIT_SIZE, Ctxt(cCoordinates[0][0].getPubKey())),
             pubKeyPtrDBG(&public_key),
             pCoordinatesDBG(DIM)
@@ -101,9 +119,7 @@ public:
     //  cCoordinates(DIM, std::vector(BIT_SIZE, helib::Ctxt(public_key)))
     {
         originalPointAddress = this;
-        for (long bit = 0; bit < cid.size(); ++bit)
-            this->public_key.Encrypt(cid[bit],
-                                     NTL::to_ZZX((id >> bit) & 1));
+        setCid(0);
 
         //        this->pCoordinatesDBG.reserve(DIM);
         this->cCoordinates.resize(DIM);//reserve(DIM);
@@ -116,8 +132,53 @@ public:
 
     }
 
+    /**
+     * @brief same as above, but takes over the coordinates instead of copying them
+     * (e.g. a point read from a \class{PointFile})
+     * */
+    Point(std::vector<EncryptedNum> &&cCoordinates, long id) :
+            cmpCounter(0), addCounter(0), multCounter(0),
+            public_key(cCoordinates[0][0].getPubKey()),
+            id(id),
+            cid(CID_BIT_SIZE, Ctxt(cCoordinates[0][0].getPubKey())),
+            pubKeyPtrDBG(&public_key),
+            cCoordinates(std::move(cCoordinates)),
+            pCoordinatesDBG(DIM) {
+        originalPointAddress = this;
+        setCid(0);
+    }
+
     bool isEmpty() const {
-        return cCoordinates[0][0].isEmpty();
+        return cCoordinates.empty() || cCoordinates[0][0].isEmpty();    //  empty also when moved-from
+    }
+
+    /**
+     * @brief set the cluster id - the index of the mean the point belongs to (0 until it is assigned).
+     * the index is public (it is the position of the mean in the list of means),
+     * so it is encoded as a trivial (noiseless) encryption of #CID_BIT_SIZE bits.
+     * */
+    Point &setCid(long index) {
+        for (long bit = 0; bit < cid.size(); ++bit)
+            cid[bit].DummyEncrypt(NTL::to_ZZX((index >> bit) & 1));
+        return *this;
+    }
+
+    /**
+     * @brief check if the (encrypted) cid equals a known mean index.
+     * @note a product of #CID_BIT_SIZE bits -
+     *  instead of a full comparison of 2 encrypted cids (which was the #NUMBER_OF_POINTS bits long id)
+     * @return encrypted bit
+     * @return CBit
+     * */
+    CBit hasCid(long index) const {
+        CBit isEqual(public_key);
+        isEqual.DummyEncrypt(NTL::ZZX(1L));
+        for (long bit = 0; bit < cid.size(); ++bit) {
+            CBit isBitEqual(cid[bit]);
+            if (!((index >> bit) & 1)) isBitEqual.addConstant(NTL::ZZX(1L));
+            isEqual.multiplyBy(isBitEqual);
+        }
+        return isEqual;
     }
 
     Point(const Point &point) :
@@ -138,15 +199,57 @@ public:
             isEmptyDBG(point.isEmptyDBG),
             isCopyDBG(true) {
         //        cout << " Point copy copy" << endl; //this print is important for later. efficiency...
-        if (!point.isEmpty())
-            for (short dim = 0; dim < DIM; ++dim) {
-                vecCopy(cCoordinates[dim], point.cCoordinates[dim]); //helibs version of vec copy //fixme throws an exception sometimes
-//                                cCoordinates[dim] = point.cCoordinates[dim];
-            }
-        else std::cerr << "point is empty!" << endl;
+        //  cCoordinates were already copied above (copying them again with vecCopy doubled the cost of every copy)
+        if (point.isEmpty()) std::cerr << "point is empty!" << endl;
 
     }
 
+    /**
+     * @brief move the ciphertexts of the point instead of copying them.
+     * @note the moved-from point is left empty (see \fn isEmpty)
+     * */
+    Point(Point &&point) noexcept:
+            cmpCounter(point.cmpCounter),
+            addCounter(point.addCounter),
+            multCounter(point.multCounter),
+            public_key(point.public_key),
+            id(point.id),
+            cid(std::move(point.cid)),
+            originalPointAddress(point.originalPointAddress),
+            pubKeyPtrDBG(&(point.public_key)),
+            cCoordinates(std::move(point.cCoordinates)),
+            pCoordinatesDBG(std::move(point.pCoordinatesDBG)),
+            isEmptyDBG(point.isEmptyDBG),
+            isCopyDBG(point.isCopyDBG) {}
+
+    /**
+     * @brief same as the copy constructor, but the ciphertexts are built in recycled ones (see \class{CtxtPool})
+     * */
+    Point(const Point &point, CtxtPool &pool) :
+            cmpCounter(point.cmpCounter),
+            addCounter(point.addCounter),
+            multCounter(point.multCounter),
+            public_key(point.public_key),
+            id(point.id),
+            cid(pool.copyOf(point.cid)),
+            originalPointAddress(point.originalPointAddress),
+            pubKeyPtrDBG(&(point.public_key)),
+            pCoordinatesDBG(point.pCoordinatesDBG),
+            isEmptyDBG(point.isEmptyDBG),
+            isCopyDBG(true) {
+        cCoordinates.reserve(point.cCoordinates.size());
+        for (const EncryptedNum &coordinate: point.cCoordinates) cCoordinates.push_back(pool.copyOf(coordinate));
+    }
+
+    /**
+     * @brief give the ciphertexts of the point back to a pool, to be reused by the next copies.
+     * @note the point is left empty (see \fn isEmpty)
+     * */
+    void recycle(CtxtPool &pool) {
+        pool.recycle(cCoordinates);
+        pool.recycle(cid);
+    }
+
     Point &operator=(const Point &point) {
         //            cout << " Point assign" << endl;
         if (&point == this || point.isEmpty()) return *this;
@@ -162,6 +265,17 @@ public:
         return *this;
     }
 
+    //  same as the copy assignment - the id is kept
+    Point &operator=(Point &&point) noexcept {
+        if (&point == this || point.isEmpty()) return *this;
+        cid = std::move(point.cid);
+        originalPointAddress = point.originalPointAddress;
+        cCoordinates = std::move(point.cCoordinates);
+        if (!point.pCoordinatesDBG.empty())
+            pCoordinatesDBG = std::move(point.pCoordinatesDBG);
+        return *this;
+    }
+
     const EncryptedNum &operator[](short int i) const {
         //        if (isEmpty()) return EncryptedNum(helib::Ctxt(public_key));
         return cCoordinates[i];
@@ -419,39 +533,126 @@ public:
         return id == point.id;
     }
 
+    //! @var DistanceKernel distanceKernel
+    //! the kernel used by \fn{squaredDistance} when none is given (initialized from the config, can be changed at runtime)
+    static inline DistanceKernel distanceKernel = DISTANCE_KERNEL == "cmp" ? DistanceKernel::CMP
+                                                                           : DistanceKernel::SQUARED_DIFF;
+
     /**
-     * @brief return the encrypted (square of the) distance
-     * @param point from which we measure our distance
-     * @return encrypted (square of the) distance from point
+     * @brief the encrypted square of the euclidean distance between two sets of encrypted coordinates.
+     * @note works slot-wise, so the coordinates may hold a single point (the same value in every slot)
+     *  or many points packed into the slots (see \class{PointBatch}).
+     * @param coordinates1 #DIM encrypted numbers
+     * @param coordinates2 #DIM encrypted numbers
+     * @param kernel which circuit computes the distance (see \enum{DistanceKernel})
      * @return EncryptedNum
      * */
-    EncryptedNum
-    distanceFrom(
-            const Point &point,
-            const KeysServer &keysServer
-    ) const {
-        // this creates a problem when the diff between the original values is negative
-        //   (meaning when c1 is smaller then c2) -
-        //   the result of `subtractBinary` is a (positive) 2's compliment.
-        //   in other words it would be
-        //   sub_result = [ NUMBERS_RANGE + (c1-c2) ] mod NUMBERS_RANGE
-        // two options to fix:
-        //  1. use helib cmp w/ min/max ptrs <<---------------- this version is much faster (X4)
-        //  2. calculate (c1^2)+(c2^2)-2(c1*c2) = (c1-c2)^2
-        //  3. consult adidanny
+    static EncryptedNum
+    squaredDistance(
+            const std::vector<EncryptedNum> &coordinates1,
+            const std::vector<EncryptedNum> &coordinates2,
+            const helib::PubKey &public_key,
+            DistanceKernel kernel = distanceKernel
+    ) {
+        return (kernel == DistanceKernel::CMP)
+               ? squaredDistance_Cmp(coordinates1, coordinates2, public_key)
+               : squaredDistance_SquaredDiff(coordinates1, coordinates2, public_key);
+    }
 
-        // c1 = p1.coor[dim]      
-        // c2 = p2.coor[dim]
+    /**
+     * @brief the squared distance using the squared-difference kernel:
+     *  for each dim, d = c1 - c2 is computed in 2's complement (with one extra bit for the sign),
+     *  then |d| = (d XOR sign) + sign, with the +sign done by a (log-depth) incrementer.
+     *  the square of |d| = SUM[a_i * 2^i] is SUM[a_i * 2^2i] + SUM[a_i * a_j * 2^(i+j+1) | i < j]
+     *  (since a_i * a_i = a_i), so only half of the partial products of a multiplication are needed.
+     *  the partial products of all the dims are summed by a single \fn{addManyNumbers},
+     *  instead of a multiplication per dim followed by another sum.
+     * @return EncryptedNum
+     * */
+    static EncryptedNum
+    squaredDistance_SquaredDiff(
+            const std::vector<EncryptedNum> &coordinates1,
+            const std::vector<EncryptedNum> &coordinates2,
+            const helib::PubKey &public_key
+    ) {
+        std::vector<EncryptedNum> summands;
+        summands.reserve(DIM * BIT_SIZE);
+        for (int dim = 0; dim < DIM; ++dim) {
+            //  pad both with a 0 msb, so the difference keeps its sign bit
+            EncryptedNum thisCoor = coordinates1[dim], pointCoor = coordinates2[dim];
+            thisCoor.emplace_back(public_key);
+            pointCoor.emplace_back(public_key);
+            helib::CtPtrs_vectorCt p1c(thisCoor), p2c(pointCoor);
+
+            // subtract: c1 - c2 (2's complement, BIT_SIZE + 1 bits)
+            EncryptedNum diff(BIT_SIZE + 1, helib::Ctxt(public_key));
+            helib::CtPtrs_vectorCt diff_wrapper(diff);
+            helib::subtractBinary(diff_wrapper, p1c, p2c);
+
+            // |c1 - c2| = (diff XOR sign) + sign
+            const Ctxt &sign = diff[BIT_SIZE];
+            EncryptedNum absDiff(diff.begin(), diff.begin() + BIT_SIZE);
+            for (Ctxt &bit: absDiff) bit += sign;
+            increment(absDiff, sign);
+
+            // square: the diagonal a_i * 2^2i
+            EncryptedNum diagonal(OUT_SIZE, helib::Ctxt(public_key));
+            for (long i = 0; i < BIT_SIZE; ++i) diagonal[2 * i] = absDiff[i];
+            summands.push_back(std::move(diagonal));
+            // square: the rest, each a_i * a_j (i < j) once, shifted by one more bit to count it twice
+            for (long i = 0; i < BIT_SIZE - 1; ++i) {
+                EncryptedNum row(OUT_SIZE, helib::Ctxt(public_key));
+                for (long j = i + 1; j < BIT_SIZE; ++j) {
+                    row[i + j + 1] = absDiff[i];
+                    row[i + j + 1] *= absDiff[j];
+                }
+                summands.push_back(std::move(row));
+            }
+        }
+
+        // sum: SUM[ ( c1-c2 )^2 | for all dim ]
+        helib::CtPtrMat_vectorCt summands_wrapper(summands);
+        EncryptedNum result_vector;
+        helib::CtPtrs_vectorCt output_wrapper(result_vector);
+        helib::addManyNumbers(output_wrapper, summands_wrapper,
+                              OUT_SIZE + long(std::ceil(std::log2(DIM))));
 
-        /**     option 1    */
-        auto t0_distanceFrom_cmp_version = CLOCK::now();
+        return result_vector;
+    }
+
+    /**
+     * @brief add an encrypted bit to an encrypted number (in place, modulo 2^num.size()).
+     *  the carry into bit i is carry * num[0] * ... * num[i-1], and these prefix products are computed
+     *  in log(num.size()) rounds (instead of a chain of num.size() multiplications), to keep the depth low.
+     * */
+    static void increment(EncryptedNum &num, const Ctxt &carry) {
+        //  prefix[i] = carry * num[0] * ... * num[i-1]
+        std::vector<Ctxt> prefix;
+        prefix.reserve(num.size());
+        prefix.push_back(carry);
+        for (long i = 0; i + 1 < num.size(); ++i) prefix.push_back(num[i]);
+        for (long shift = 1; shift < prefix.size(); shift *= 2)
+            for (long i = long(prefix.size()) - 1; i >= shift; --i) prefix[i] *= prefix[i - shift];
+        for (long i = 0; i < num.size(); ++i) num[i] += prefix[i];
+    }
 
+    /**
+     * @brief the squared distance using helib's comparison - max{c1,c2} - min{c1,c2} = |c1 - c2| for each dim,
+     *  multiplied by itself, and then all the dims are summed.
+     * @return EncryptedNum
+     * */
+    static EncryptedNum
+    squaredDistance_Cmp(
+            const std::vector<EncryptedNum> &coordinates1,
+            const std::vector<EncryptedNum> &coordinates2,
+            const helib::PubKey &public_key
+    ) {
         std::vector<EncryptedNum> sqaredDiffs(DIM);
         for (int dim = 0; dim < DIM; ++dim) {
 
-            EncryptedNum thisCoor = this->cCoordinates[dim];
+            EncryptedNum thisCoor = coordinates1[dim];
             helib::CtPtrs_vectorCt p1c(thisCoor);
-            EncryptedNum pointCoor = point.cCoordinates[dim];
+            EncryptedNum pointCoor = coordinates2[dim];
             helib::CtPtrs_vectorCt p2c(pointCoor);
             EncryptedNum eMax, eMin;//(BIT_SIZE, helib::Ctxt(public_key));
             helib::CtPtrs_vectorCt max(eMax), min(eMin);
@@ -498,173 +699,311 @@ public:
         helib::addManyNumbers(output_wrapper, summands_wrapper);
         //        printNameVal(keysServer.decryptNum(result_vector));
 
-        loggerPoint.log(
-                printDuration(t0_distanceFrom_cmp_version, "distanceFrom (cmp version)"));
-
-        /**     option 2    */
-        /*
-                auto t0_long_version = CLOCK::now();
-
-                std::vector<EncryptedNum >
-                        parts(DIM,
-                              EncryptedNum(2 * BIT_SIZE,
-                                                       helib::Ctxt(point.public_key)));
-
-                for (int dim = 0; dim < DIM; ++dim) {
-                    // subtract: c1 - c2
-                    helib::CtPtrs_vectorCt p1c(this->cCoordinates[dim]);
-                    helib::CtPtrs_vectorCt p2c(point.cCoordinates[dim]);
-
-                    //  (c1) ^ 2
-                    EncryptedNum c1sqr;
-                    helib::CtPtrs_vectorCt sqr_wrapper1(c1sqr);
-                    helib::multTwoNumbers(sqr_wrapper1,
-                                          p1c,
-                                          p1c,
-                                          false,
-                                          2 * BIT_SIZE
-                    );
-                    //            printNameVal(keysServer.decryptNum(c1sqr));
-
-                    //  (c2) ^ 2
-                    EncryptedNum c2sqr;
-                    helib::CtPtrs_vectorCt sqr_wrapper2(c2sqr);
-                    helib::multTwoNumbers(sqr_wrapper2,
-                                          p2c,
-                                          p2c,
-                                          false,
-                                          2 * BIT_SIZE
-                    );
-                    //            printNameVal(keysServer.decryptNum(c2sqr));
-
-                    //  (c1)^2 + (c2)^2
-                    EncryptedNum sumSqrs;
-                    helib::CtPtrs_vectorCt sum_wrapper(sumSqrs);
-                    helib::addTwoNumbers(sum_wrapper,
-                                         sqr_wrapper1,
-                                         sqr_wrapper2,
-                                         2 * BIT_SIZE
-                    );
-                    //            printNameVal(keysServer.decryptNum(sumSqrs));
-
-                    //  (c1) * (c2)
-                    EncryptedNum multC1C2;
-                    helib::CtPtrs_vectorCt mult_wrapper(multC1C2);
-                    helib::multTwoNumbers(mult_wrapper,
-                                          p1c,
-                                          p2c,
-                                          false,
-                                          2 * BIT_SIZE
-                    );
-                    //            printNameVal(keysServer.decryptNum(multC1C2));
-
-                    //  2 * [(c1) * (c2)]
-                    EncryptedNum dblMultC1C2;
-                    helib::CtPtrs_vectorCt dbl_wrapper(dblMultC1C2);
-                    helib::addTwoNumbers(dbl_wrapper,
-                                         mult_wrapper,
-                                         mult_wrapper,
-                                         2 * BIT_SIZE
-                    );
-                    //            printNameVal(keysServer.decryptNum(dblMultC1C2));
-
-                    // sum: (c1^2) + (c2^2) - 2(c2*c2)
-                    helib::CtPtrs_vectorCt output(parts[dim]);
-                    helib::subtractBinary(output,
-                                          sum_wrapper,
-                                          dbl_wrapper);
-                    //            printNameVal(keysServer.decryptNum(parts[dim]));
-                }
+        return result_vector;
+    }
 
-                // sum: SUM[ ( c1-c2 )^2 | for all dim ]
-                helib::CtPtrMat_vectorCt summands_wrapper2(parts);
-                EncryptedNum result_vector2;
-                helib::CtPtrs_vectorCt output_wrapper2(result_vector2);
-                helib::addManyNumbers(output_wrapper2,
-                                      summands_wrapper2);
-                //        printNameVal(keysServer.decryptNum(result_vector));
+    /**
+     * @brief return the encrypted (square of the) distance
+     * @param point from which we measure our distance
+     * @return encrypted (square of the) distance from point
+     * @return EncryptedNum
+     * */
+    EncryptedNum
+    distanceFrom(
+            const Point &point,
+            const KeysServer &keysServer
+    ) const {
+        // the diff between the original values may be negative (when c1 is smaller then c2) -
+        //   the result of `subtractBinary` is then a (positive) 2's compliment:
+        //   sub_result = [ NUMBERS_RANGE + (c1-c2) ] mod NUMBERS_RANGE
+        // two kernels handle that (see \enum{DistanceKernel}):
+        //  1. use helib cmp w/ min/max ptrs
+        //  2. subtract with a sign bit, and take the absolute value w/o a comparison (faster, and shallower)
 
-                loggerPoint.log(printDuration(t0_long_version, "dist long version (without compare)"));
-                */
+        // c1 = p1.coor[dim]
+        // c2 = p2.coor[dim]
+
+        auto t0_distanceFrom = CLOCK::now();
+
+        EncryptedNum result_vector = squaredDistance(this->cCoordinates, point.cCoordinates, public_key);
+
+        loggerPoint.log(printDuration(
+                t0_distanceFrom,
+                distanceKernel == DistanceKernel::CMP ? "distanceFrom (cmp version)" : "distanceFrom (squared diff version)"));
 
         return result_vector;
     }
 
+    /**
+     * @brief oblivious select of one of 2 points - bitwise a + cond * (a + b), so one multiplication per bit
+     * (instead of masking both points and adding them with an adder)
+     * @returns b if cond is 1, and a if it is 0 (both the coordinates and the cid)
+     * @return Point
+     * */
+    static Point select(const Point &a, const Point &b, const Ctxt &cond) {
+        std::vector<EncryptedNum> cCoordinates(a.cCoordinates);
+        EncryptedNum cid(a.cid);
+        auto selectBits = [&cond](EncryptedNum &result, const EncryptedNum &other) {
+            for (long bit = 0; bit < result.size(); ++bit) {
+                Ctxt diff(result[bit]);
+                diff += other[bit];
+                diff *= cond;
+                result[bit] += diff;
+            }
+        };
+        for (short dim = 0; dim < DIM; ++dim) selectBits(cCoordinates[dim], b.cCoordinates[dim]);
+        selectBits(cid, b.cid);
+
+        Point selected(std::move(cCoordinates), a.id);
+        selected.cid = std::move(cid);
+        return selected;
+    }
+
+    /**
+     * @brief one match of the tournament in \fn findMinDistFromMeans
+     * @param isSecondCloser if given, set to the result of the match (1 if b is closer)
+     * @returns the closer of the 2 candidates (a, on a tie) and its distance
+     * */
+    static std::pair<Point, EncryptedNum>
+    closerOf(std::pair<Point, EncryptedNum> &a, std::pair<Point, EncryptedNum> &b, Ctxt *isSecondCloser = nullptr) {
+        EncryptedNum eMax, eMin;
+        helib::CtPtrs_vectorCt max(eMax), min(eMin);
+        helib::Ctxt mu(a.first.public_key), ni(a.first.public_key);
+        helib::compareTwoNumbers(max, min,
+                                 mu, ni,
+                                 helib::CtPtrs_vectorCt(a.second),
+                                 helib::CtPtrs_vectorCt(b.second),
+                                 false,
+                                 &(KeysServer::unpackSlotEncoding));
+        //  mu = a > b
+        if (isSecondCloser) *isSecondCloser = mu;
+        return {select(a.first, b.first, mu), std::move(eMin)};
+    }
+
+    /**
+     * @brief the one-hot assignment of the winner of a match, from the ones of the 2 candidates:
+     *  [a * (1 - mu), b * mu] - one multiplication per bit
+     * @param a, b the one-hot assignments of the candidates (each over the candidates of its own part of the tournament)
+     * @param mu the result of the match (1 if b is closer)
+     * @return std::vector<CBit>
+     * */
+    static std::vector<CBit>
+    mergeOneHot(const std::vector<CBit> &a, const std::vector<CBit> &b, const Ctxt &mu) {
+        std::vector<CBit> merged(a);
+        merged.reserve(a.size() + b.size());
+        for (CBit &bit: merged) {
+            CBit bitAndMu(bit);
+            bitAndMu *= mu;
+            bit += bitAndMu;    //  bit * (1 + mu), and 1 + mu = 1 - mu = !mu
+        }
+        for (const CBit &bit: b) {
+            merged.push_back(bit);
+            merged.back() *= mu;
+        }
+        return merged;
+    }
+
     /**
      * @brief find closest point, from a list, and minimal distance from it
      * @param points list of points from which we measure our distance
+     * @param threadPool if given, the distances, and the matches of every level, are computed in parallel
+     * @note a tournament (tree) argmin - the closest point is found in log2(points.size()) levels of comparisons
+     *  (instead of a chain of points.size() comparisons & selects), which also keeps the multiplicative depth logarithmic.
+     *  the closest point carries its cid (the index of the mean) along.
+     * @param oneHot if given, set to the encrypted one-hot assignment - a bit per point, which is 1 only for the closest
+     *  (so grouping by the closest mean is an AND per mean, instead of matching the cid)
      * @return minimal distance and corresponding closest point
      * @return std::pair<Point, EncryptedNum>
      * */
     std::pair<Point, EncryptedNum>
     findMinDistFromMeans(
             const std::vector<Point> &points,
-            const KeysServer &keysServer
+            const KeysServer &keysServer,
+            ThreadPool *threadPool = nullptr,
+            std::vector<CBit> *oneHot = nullptr
     ) const {
         auto t0_minDist = CLOCK::now();
 
         //  Collect Distancses from Means
-        std::vector<std::pair<const Point &, EncryptedNum> > distances;
-        distances.reserve(points.size());
-        for (const Point &mean:points)
-            distances.emplace_back(mean, distanceFrom(mean, keysServer));
-        //   distances.push_back(
-        //                    std::pair<const Point &, EncryptedNum>(mean, distanceFrom(mean, keysServer)));
+        std::vector<std::pair<Point, EncryptedNum> > level;
+        level.reserve(points.size());
+        if (threadPool) {
+            std::vector<std::future<EncryptedNum> > futures;
+            futures.reserve(points.size());
+            for (const Point &mean: points)
+                futures.push_back(threadPool->submit(&Point::distanceFrom, this, std::cref(mean), std::cref(keysServer)));
+            for (int i = 0; i < points.size(); ++i) level.emplace_back(points[i], threadPool->wait(futures[i]));
+        } else
+            for (const Point &mean: points) level.emplace_back(mean, distanceFrom(mean, keysServer));
+
+        std::pair<Point, EncryptedNum> closest = argmin(std::move(level), threadPool, oneHot);
 
-        // init minimal distance
-        Point closestPoint(distances[0].first);
-        EncryptedNum minimalDistance(distances[0].second);
-
-        for (std::pair<const Point &, EncryptedNum> &tuplePointDistance:distances) {
+        loggerPoint.log(printDuration(t0_minDist, "findMinDistFromMeans"));
 
-            EncryptedNum eMax,//(BIT_SIZE, helib::Ctxt(public_key)),
-            eMin;//(BIT_SIZE, helib::Ctxt(public_key));
-            helib::CtPtrs_vectorCt max(eMax), min(eMin);
-            helib::CtPtrs_vectorCt distMin(minimalDistance);
-            helib::CtPtrs_vectorCt dist(tuplePointDistance.second);
+        return closest;
+    }
 
-            helib::Ctxt mu(public_key), ni(public_key);
+    /**
+     * @brief the tournament of \fn findMinDistFromMeans, over distances that were already computed
+     *  (e.g. a row of a \class{DistanceMatrix})
+     * @param level pairs of a candidate and its distance
+     * @param threadPool if given, the matches of every level are computed in parallel
+     * @param oneHot if given, set to the one-hot assignment of the closest candidate (a bit per candidate, in order).
+     *  it is a by-product of the matches: each candidate carries the one-hot over its part of the tournament,
+     *  and the winner's is merged from the 2 (see \fn mergeOneHot)
+     * @return the closest candidate (the first one, on a tie) and its distance
+     * @return std::pair<Point, EncryptedNum>
+     * */
+    static std::pair<Point, EncryptedNum>
+    argmin(std::vector<std::pair<Point, EncryptedNum> > level,
+           ThreadPool *threadPool = nullptr,
+           std::vector<CBit> *oneHot = nullptr) {
+        //  before the first match each candidate is the closest of its own part
+        std::vector<std::vector<CBit> > oneHots;
+        if (oneHot) {
+            oneHots.reserve(level.size());
+            for (const auto &candidate: level) {
+                CBit one(candidate.first.public_key);
+                one.DummyEncrypt(NTL::ZZX(1L));
+                oneHots.push_back({one});
+            }
+        }
 
-            helib::compareTwoNumbers(max, min,
-                                     mu, ni,
-                                     distMin,
-                                     dist,
-                                     false,
-                                     &(KeysServer::unpackSlotEncoding));
-
-            //  eMin (and min.v) created by vecCopy
-            //  and therefore will always have a different address from tuplePointDistance.first
-            //  ... so need to use helib's compare again?
-            //            helib::binaryCond(minimalDistance.first, mu, distMin, dist);
-            Ctxt negated_cond(mu);
-            negated_cond.addConstant(NTL::ZZX(1L));
-            //            cout << endl << "min" << endl;
-            //            printPoint(minimalDistance.first, keysServer);
-            //            cout << endl << "min*(!mu)" << endl;
-            //            printPoint(minimalDistance.first * negated_cond, keysServer);
-            //            cout << endl << "dist" << endl;
-            //            printPoint(tuplePointDistance.first, keysServer);
-            //            cout << endl << "dist*(mu)" << endl;
-            //            printPoint(tuplePointDistance.first * mu, keysServer);
-            //            cout << endl << "min*(!mu) + dist*(mu)" << endl;
-            closestPoint = closestPoint * negated_cond + tuplePointDistance.first * mu;
-            minimalDistance = eMin;
-            //            minimalDistance.first = minimalDistance.first * negated_cond + tuplePointDistance.first * mu;
-            //            minimalDistance.second = eMin;
-            //        printPoint(closestPoint, keysServer);
-            //        printNameVal(keysServer.decryptNum(minimalDistance));
-            //            cout << "------------------------" << endl;
-            loggerPoint.log(printDuration(t0_minDist,
-                                          "tuplePointDistance loop in findMinDistFromMeans"));
+        //  the tournament - the winners of every level (and a candidate without a rival) go up to the next one
+        while (1 < level.size()) {
+            std::vector<std::pair<Point, EncryptedNum> > nextLevel;
+            nextLevel.reserve((level.size() + 1) / 2);
+            std::vector<Ctxt> mus(oneHot ? level.size() / 2 : 0, Ctxt(level.front().first.public_key));
+            auto muOf = [&mus, oneHot](int i) { return oneHot ? &mus[i / 2] : nullptr; };
+            if (threadPool) {
+                std::vector<std::future<std::pair<Point, EncryptedNum> > > futures;
+                for (int i = 0; i + 1 < level.size(); i += 2)
+                    futures.push_back(threadPool->submit(&Point::closerOf,
+                                                         std::ref(level[i]), std::ref(level[i + 1]), muOf(i)));
+                for (auto &future: futures) nextLevel.push_back(threadPool->wait(future));
+            } else
+                for (int i = 0; i + 1 < level.size(); i += 2)
+                    nextLevel.push_back(closerOf(level[i], level[i + 1], muOf(i)));
+            if (level.size() % 2) nextLevel.push_back(std::move(level.back()));
+
+            if (oneHot) {
+                std::vector<std::vector<CBit> > nextOneHots;
+                nextOneHots.reserve(nextLevel.size());
+                if (threadPool) {
+                    std::vector<std::future<std::vector<CBit> > > futures;
+                    for (int i = 0; i + 1 < oneHots.size(); i += 2)
+                        futures.push_back(threadPool->submit(&Point::mergeOneHot,
+                                                             std::cref(oneHots[i]),
+                                                             std::cref(oneHots[i + 1]),
+                                                             std::cref(mus[i / 2])));
+                    for (auto &future: futures) nextOneHots.push_back(threadPool->wait(future));
+                } else
+                    for (int i = 0; i + 1 < oneHots.size(); i += 2)
+                        nextOneHots.push_back(mergeOneHot(oneHots[i], oneHots[i + 1], mus[i / 2]));
+                if (oneHots.size() % 2) nextOneHots.push_back(std::move(oneHots.back()));
+                oneHots = std::move(nextOneHots);
+            }
+            level = std::move(nextLevel);
         }
+        if (oneHot) *oneHot = std::move(oneHots.front());
 
         //        cout << "     Final: " << endl;
-        //        printPoint(closestPoint, keysServer);
-        //        printNameVal(keysServer.decryptNum(minimalDistance));
+        //        printPoint(level.front().first, keysServer);
+        //        printNameVal(keysServer.decryptNum(level.front().second));
 
-        loggerPoint.log(printDuration(t0_minDist, "findMinDistFromMeans"));
+        return std::move(level.front());
+    }
 
-        return {closestPoint, minimalDistance};
+    /**
+     * @brief one comparator of \fn sortByDim - only the comparison bits are computed (not the max/min numbers),
+     *  and the 2 outputs share one product per bit: d = (a + b) * mu, min = a + d, max = b + d
+     * @returns {the smaller, the bigger} of the 2 points, by the coordinate dim (a, b on a tie)
+     * @return std::pair<Point, Point>
+     * */
+    static std::pair<Point, Point> minMaxByDim(const Point &a, const Point &b, short dim) {
+        helib::Ctxt mu(a.public_key), ni(a.public_key);
+        helib::compareTwoNumbers(mu, ni,
+                                 helib::CtPtrs_vectorCt(a.cCoordinates[dim]),
+                                 helib::CtPtrs_vectorCt(b.cCoordinates[dim]),
+                                 false,
+                                 &(KeysServer::unpackSlotEncoding));
+        //  mu = a > b
+        std::vector<EncryptedNum> minCoordinates(a.cCoordinates), maxCoordinates(b.cCoordinates);
+        EncryptedNum minCid(a.cid), maxCid(b.cid);
+        auto swapBits = [&mu](EncryptedNum &min, EncryptedNum &max) {
+            for (long bit = 0; bit < min.size(); ++bit) {
+                Ctxt diff(min[bit]);
+                diff += max[bit];
+                diff *= mu;
+                min[bit] += diff;
+                max[bit] += diff;
+            }
+        };
+        for (short d = 0; d < DIM; ++d) swapBits(minCoordinates[d], maxCoordinates[d]);
+        swapBits(minCid, maxCid);
+
+        Point min(std::move(minCoordinates), a.id), max(std::move(maxCoordinates), b.id);
+        min.cid = std::move(minCid);
+        max.cid = std::move(maxCid);
+        return {std::move(min), std::move(max)};
+    }
+
+    /**
+     * @brief oblivious sort of points by one coordinate - Batcher's odd-even merge sort network.
+     *  the network is fixed by the number of points alone, so nothing about the order is revealed.
+     *  every comparator is a comparison and one product per bit for both outputs (see \fn minMaxByDim),
+     *  O(n log^2 n) comparators in O(log^2 n) layers - and the comparators of a layer are independent.
+     * @param threadPool if given, the comparators of every layer are computed in parallel
+     * @note the sorted points are new points, with new ids (which point ended up where is encrypted)
+     * @return std::vector<Point> sorted in ascending order of the coordinate dim
+     * */
+    static std::vector<Point> sortByDim(std::vector<Point> points, short dim, ThreadPool *threadPool = nullptr) {
+        const long n = points.size();
+        long size = 1;  //  the network of the next power of 2 - the comparators of the missing (+inf) points are dropped
+        while (size < n) size <<= 1;
+
+        std::vector<std::unique_ptr<Point> > sorted;
+        sorted.reserve(n);
+        for (Point &point: points) sorted.push_back(std::make_unique<Point>(std::move(point)));
+
+        for (long p = 1; p < size; p <<= 1)
+            for (long k = p; 1 <= k; k >>= 1) {
+                //  a layer
+                std::vector<std::pair<long, long> > comparators;
+                for (long j = k % p; j + k < size; j += 2 * k)
+                    for (long i = 0; i < std::min(k, size - j - k); ++i)
+                        if ((i + j) / (2 * p) == (i + j + k) / (2 * p) && i + j + k < n)
+                            comparators.emplace_back(i + j, i + j + k);
+
+                std::vector<std::pair<Point, Point> > results;
+                results.reserve(comparators.size());
+                if (threadPool) {
+                    std::vector<std::future<std::pair<Point, Point> > > futures;
+                    futures.reserve(comparators.size());
+                    for (auto const &[first, second]: comparators)
+                        futures.push_back(threadPool->submit(&Point::minMaxByDim,
+                                                             std::cref(*sorted[first]),
+                                                             std::cref(*sorted[second]),
+                                                             dim));
+                    for (auto &future: futures) results.push_back(threadPool->wait(future));
+                } else
+                    for (auto const &[first, second]: comparators)
+                        results.push_back(minMaxByDim(*sorted[first], *sorted[second], dim));
+
+                for (long c = 0; c < comparators.size(); ++c) {
+                    sorted[comparators[c].first] = std::make_unique<Point>(std::move(results[c].first));
+                    sorted[comparators[c].second] = std::make_unique<Point>(std::move(results[c].second));
+                }
+            }
+
+        //  new ids - the comparisons made with the old ones don't hold for the sorted points
+        std::vector<Point> result;
+        result.reserve(n);
+        for (std::unique_ptr<Point> &point: sorted) {
+            result.emplace_back(std::move(point->cCoordinates), counter++);
+            result.back().cid = std::move(point->cid);
+        }
+        return result;
     }
 
 
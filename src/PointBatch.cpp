@@ -0,0 +1,149 @@
+
+#include "PointBatch.h"
+
+static Logger loggerPointBatch(log_debug, "loggerPointBatch");
+
+PointBatch::PointBatch(
+        const helib::PubKey &public_key,
+        const std::vector<DecryptedPoint> &coordinates) :
+        public_key(public_key),
+        cCoordinates(DIM, EncryptedNum(BIT_SIZE, helib::Ctxt(public_key))) {
+    const helib::EncryptedArray &ea = public_key.getContext().getEA();
+    if (coordinates.size() > ea.size())
+        throw std::invalid_argument("a PointBatch holds at most one point per slot");
+
+    ids.reserve(coordinates.size());
+    for (unsigned long i = 0; i < coordinates.size(); ++i) ids.push_back(counter++);
+
+    std::vector<long> slots(ea.size());
+    for (short dim = 0; dim < DIM; ++dim)
+        for (long bit = 0; bit < BIT_SIZE; ++bit) {
+            // Extract the bit'th bit of every point's coordinates[dim], one point per slot
+            std::fill(slots.begin(), slots.end(), 0);
+            for (unsigned long i = 0; i < coordinates.size(); ++i)
+                slots[i] = (coordinates[i][dim] >> bit) & 1;
+            ea.encrypt(cCoordinates[dim][bit], public_key, slots);
+        }
+}
+
+PointBatch::PointBatch(
+        const helib::PubKey &public_key,
+        std::vector<long> ids,
+        std::vector<EncryptedNum> cCoordinates) :
+        public_key(public_key),
+        ids(std::move(ids)),
+        cCoordinates(std::move(cCoordinates)) {}
+
+std::vector<PointBatch>
+PointBatch::pack(
+        const helib::PubKey &public_key,
+        const std::vector<DecryptedPoint> &coordinates) {
+    const unsigned long batchSize = slotsCount(public_key);
+    std::vector<PointBatch> batches;
+    batches.reserve(coordinates.size() / batchSize + 1);
+    for (unsigned long first = 0; first < coordinates.size(); first += batchSize) {
+        const unsigned long last = std::min(first + batchSize, (unsigned long) coordinates.size());
+        batches.emplace_back(public_key,
+                             std::vector<DecryptedPoint>(coordinates.begin() + first, coordinates.begin() + last));
+    }
+    return batches;
+}
+
+std::vector<CBit>
+PointBatch::isBiggerThan(const Point &point, short currentDim) const {
+    Ctxt mu(public_key), ni(public_key);
+    EncryptedNum c = cCoordinates[currentDim];
+    EncryptedNum coor = point[currentDim];
+    compareTwoNumbers(mu,
+                      ni,
+                      helib::CtPtrs_vectorCt(c),
+                      helib::CtPtrs_vectorCt(coor),
+                      false,
+                      &KeysServer::unpackSlotEncoding
+    );
+
+    // the slot holding the point itself (if any) answers true for both, same as Point::isBiggerThan
+    const helib::EncryptedArray &ea = public_key.getContext().getEA();
+    std::vector<long> isSamePoint(ea.size(), 0);
+    bool found = false;
+    for (long i = 0; i < size(); ++i)
+        if (ids[i] == point.id) isSamePoint[i] = found = true;
+    if (found) {
+        NTL::ZZX sameMask;
+        ea.encode(sameMask, isSamePoint);
+        for (Ctxt *bit: {&mu, &ni}) {
+            //  bit = bit OR same = bit + same - bit * same
+            Ctxt bitAndSame(*bit);
+            bitAndSame.multByConstant(sameMask);
+            bit->addConstant(sameMask);
+            *bit -= bitAndSame;
+        }
+    }
+    return std::vector<CBit>{mu, ni};
+}
+
+EncryptedNum
+PointBatch::distanceFrom(const Point &point) const {
+    return Point::squaredDistance(cCoordinates, point.cCoordinates, public_key);
+}
+
+std::pair<PointBatch, EncryptedNum>
+PointBatch::findMinDistFromMeans(const std::vector<Point> &means) const {
+    auto t0_minDist = CLOCK::now();
+
+    // init minimal distance
+    std::vector<EncryptedNum> closest = means[0].cCoordinates;
+    EncryptedNum minimalDistance = distanceFrom(means[0]);
+
+    for (unsigned long i = 1; i < means.size(); ++i) {
+        EncryptedNum distance = distanceFrom(means[i]);
+
+        EncryptedNum eMax, eMin;
+        helib::CtPtrs_vectorCt max(eMax), min(eMin);
+        helib::Ctxt mu(public_key), ni(public_key);
+        helib::compareTwoNumbers(max, min,
+                                 mu, ni,
+                                 helib::CtPtrs_vectorCt(minimalDistance),
+                                 helib::CtPtrs_vectorCt(distance),
+                                 false,
+                                 &(KeysServer::unpackSlotEncoding));
+
+        //  slot-wise: closest = closest * (!mu) + mean * mu
+        Ctxt negated_cond(mu);
+        negated_cond.addConstant(NTL::ZZX(1L));
+        for (short dim = 0; dim < DIM; ++dim)
+            for (long bit = 0; bit < closest[dim].size(); ++bit) {
+                Ctxt meanBit(means[i].cCoordinates[dim][bit]);
+                meanBit *= mu;
+                closest[dim][bit] *= negated_cond;
+                closest[dim][bit] += meanBit;
+            }
+        minimalDistance = eMin;
+    }
+
+    loggerPointBatch.log(printDuration(t0_minDist, "PointBatch::findMinDistFromMeans"));
+
+    return {PointBatch(public_key, ids, closest), minimalDistance};
+}
+
+PointBatch PointBatch::operator*(const Ctxt &bits) const {
+    PointBatch product(public_key, ids, cCoordinates);
+    for (short dim = 0; dim < DIM; ++dim) {
+        helib::CtPtrs_vectorCt result_wrapper(product.cCoordinates[dim]);
+        binaryMask(result_wrapper, bits);
+    }
+    return product;
+}
+
+Point PointBatch::extract(long slot) const {
+    std::vector<EncryptedNum> coordinates(cCoordinates);
+    for (EncryptedNum &coordinate: coordinates)
+        for (Ctxt &bit: coordinate) bit = extractBit(bit, slot);
+    return Point(coordinates, ids[slot]);
+}
+
+Ctxt PointBatch::extractBit(const Ctxt &bits, long slot) {
+    Ctxt replicated(bits);
+    helib::replicate(bits.getContext().getEA(), replicated, slot);
+    return replicated;
+}
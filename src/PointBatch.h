@@ -0,0 +1,100 @@
+
+#ifndef ENCRYPTEDKMEANS_POINTBATCH_H
+#define ENCRYPTEDKMEANS_POINTBATCH_H
+
+#include <helib/replicate.h>
+
+#include "Point.h"
+
+/**
+ * @class PointBatch
+ * @brief A batch of points packed into the slots of the same ciphertexts (SIMD).
+ * Bit b of coordinate dim of the i'th point sits in slot i of cCoordinates[dim][b],
+ *  so every homomorphic operation on the batch is applied to all of its points at once.
+ *  i.e. b0 = [0] [1] [1] ... [0] [0] [0]        ciphertext for bit 0 of (p0, p1, p2, ..., unused slots)
+ *       b1 = [1] [1] [0] ... [0] [0] [0]        ciphertext for bit 1 of (p0, p1, p2, ..., unused slots)
+ * @note A regular \class{Point} holds the same value in every slot,
+ *  so a batch can be compared with (or measured from) a single point - a rep or a mean - with no rotations.
+ * */
+class PointBatch {
+public:
+    const helib::PubKey &public_key;
+
+    //! @var std::vector<long> ids
+    //! ids[i] is the id of the point packed in slot i. ids.size() is the number of packed points
+    //! (the slots after it are unused, and their ciphertext values are zero)
+    std::vector<long> ids;
+    std::vector<EncryptedNum> cCoordinates;
+
+    /**
+     * @brief encrypt up to #slotsCount points into one batch
+     * @param coordinates a list of (plaintext) points
+     * */
+    PointBatch(const helib::PubKey &public_key, const std::vector<DecryptedPoint> &coordinates);
+
+    /**
+     * @brief a batch built from already encrypted (packed) coordinates
+     * */
+    PointBatch(const helib::PubKey &public_key, std::vector<long> ids, std::vector<EncryptedNum> cCoordinates);
+
+    long size() const {
+        return ids.size();
+    }
+
+    /**
+     * @brief the number of points that fit into one batch
+     * */
+    static long slotsCount(const helib::PubKey &public_key) {
+        return public_key.getContext().getEA().size();
+    }
+
+    /**
+     * @brief split a list of (plaintext) points into as few batches as possible
+     * @return std::vector<PointBatch>
+     * */
+    static std::vector<PointBatch>
+    pack(const helib::PubKey &public_key, const std::vector<DecryptedPoint> &coordinates);
+
+    /**
+     * @brief compares all the points in the batch to a point, in a specified dimension.
+     * @returns the packed answers to ((batch[i][d] > point[d]), (point[d] > batch[i][d])), for every slot i.
+     *  (a slot holding the point itself answers true for both, like \fn{Point::isBiggerThan})
+     * @return std::vector<CBit>
+     * */
+    std::vector<CBit>
+    isBiggerThan(const Point &point, short currentDim = DIM - 1) const;
+
+    /**
+     * @brief the packed (squares of the) distances of all the points in the batch from a point
+     * @return EncryptedNum
+     * */
+    EncryptedNum
+    distanceFrom(const Point &point) const;
+
+    /**
+     * @brief find for every point in the batch the closest point from a list, and the minimal distance from it
+     * @param means list of points from which we measure our distance
+     * @return the packed closest means and the packed minimal distances
+     * @return std::pair<PointBatch, EncryptedNum>
+     * */
+    std::pair<PointBatch, EncryptedNum>
+    findMinDistFromMeans(const std::vector<Point> &means) const;
+
+    /**
+     * @brief Multiplies every point in the batch by its own bit (slot-wise)
+     * */
+    PointBatch operator*(const Ctxt &bits) const;
+
+    /**
+     * @brief unpack the point in a given slot into a regular \class{Point} (the same value in all slots)
+     * */
+    Point extract(long slot) const;
+
+    /**
+     * @brief replicate the bit in a given slot into all the slots
+     * */
+    static Ctxt extractBit(const Ctxt &bits, long slot);
+};
+
+
+#endif //ENCRYPTEDKMEANS_POINTBATCH_H
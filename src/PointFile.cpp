@@ -0,0 +1,116 @@
+
+#include "PointFile.h"
+
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static Logger loggerPointFile(log_debug, "loggerPointFile");
+
+/**
+ * a read-only memory mapping of a whole file, exposed as a stream buffer
+ * (so helib's readers parse the ciphertexts straight from the mapped pages, with no intermediate buffer)
+ * */
+class MappedFile : public std::streambuf {
+public:
+    explicit MappedFile(const std::string &filename) {
+        const int fd = open(filename.c_str(), O_RDONLY);
+        if (-1 == fd) throw std::runtime_error("can't open " + filename);
+        struct stat fileStat{};
+        fstat(fd, &fileStat);
+        size = fileStat.st_size;
+        data = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+        close(fd);  //  the mapping stays valid
+        if (MAP_FAILED == data) throw std::runtime_error("can't map " + filename);
+        if (data) madvise(data, size, MADV_SEQUENTIAL);
+        char *begin = static_cast<char *>(data);
+        setg(begin, begin, begin + size);
+    }
+
+    ~MappedFile() override {
+        if (data) munmap(data, size);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+private:
+    void *data;
+    size_t size;
+};
+
+static void writeLong(std::ostream &stream, int64_t num) {
+    stream.write(reinterpret_cast<const char *>(&num), sizeof(num));
+}
+
+static int64_t readLong(std::istream &stream) {
+    int64_t num = 0;
+    stream.read(reinterpret_cast<char *>(&num), sizeof(num));
+    return num;
+}
+
+void PointFile::write(const std::vector<Point> &points, const std::string &filename) {
+    auto t0_write = CLOCK::now();     //  for logging, profiling, DBG
+
+    std::ofstream stream(filename, std::ios::binary);
+    stream.write(MAGIC, sizeof(MAGIC));
+    for (int64_t num: {VERSION, int64_t(points.size()), int64_t(DIM), int64_t(BIT_SIZE), int64_t(CID_BIT_SIZE)})
+        writeLong(stream, num);
+
+    for (const Point &point: points) {
+        writeLong(stream, point.id);
+        for (const Ctxt &bit: point.cid) bit.writeTo(stream);
+        for (short dim = 0; dim < DIM; ++dim)
+            for (const Ctxt &bit: point[dim]) bit.writeTo(stream);
+    }
+
+    loggerPointFile.log(printDuration(t0_write, "PointFile::write"));
+}
+
+long PointFile::read(
+        const std::string &filename,
+        const helib::PubKey &public_key,
+        const std::function<void(Point &&)> &onPoint
+) {
+    auto t0_read = CLOCK::now();     //  for logging, profiling, DBG
+
+    MappedFile mappedFile(filename);
+    std::istream stream(&mappedFile);
+
+    char magic[sizeof(MAGIC)];
+    stream.read(magic, sizeof(magic));
+    if (!stream || !std::equal(magic, magic + sizeof(magic), MAGIC))
+        throw std::runtime_error(filename + " is not a points file");
+    if (VERSION != readLong(stream)) throw std::runtime_error(filename + ": unknown version");
+    const int64_t numOfPoints = readLong(stream);
+    if (DIM != readLong(stream) || BIT_SIZE != readLong(stream) || CID_BIT_SIZE != readLong(stream))
+        throw std::runtime_error(filename + ": DIM / BIT_SIZE / CID_BIT_SIZE don't match this build");
+
+    for (int64_t i = 0; i < numOfPoints; ++i) {
+        readLong(stream);   //  the id the point had in the process that wrote it - informational only
+        std::vector<EncryptedNum> cCoordinates(DIM, EncryptedNum(BIT_SIZE, Ctxt(public_key)));
+        EncryptedNum cid(CID_BIT_SIZE, Ctxt(public_key));
+        for (Ctxt &bit: cid) bit.read(stream);
+        for (EncryptedNum &coordinate: cCoordinates)
+            for (Ctxt &bit: coordinate) bit.read(stream);
+        if (!stream) throw std::runtime_error(filename + ": truncated at point #" + std::to_string(i));
+
+        //  a fresh id - the writers number their points independently, so the ids in files collide
+        //  (with each other, and with the points created here), and everything keyed by id relies on them
+        Point point(std::move(cCoordinates), counter++);
+        point.cid = std::move(cid);
+        onPoint(std::move(point));
+    }
+
+    loggerPointFile.log(printDuration(t0_read, "PointFile::read (" + std::to_string(numOfPoints) + " points)"));
+    return numOfPoints;
+}
+
+std::vector<Point> PointFile::read(const std::string &filename, const helib::PubKey &public_key) {
+    std::vector<Point> points;
+    read(filename, public_key, [&points](Point &&point) { points.push_back(std::move(point)); });
+    return points;
+}
@@ -0,0 +1,45 @@
+#ifndef ENCRYPTEDKMEANS_POINTFILE_H
+#define ENCRYPTEDKMEANS_POINTFILE_H
+
+#include <functional>
+
+#include "Point.h"
+
+/**
+ * @class PointFile
+ * @brief A binary file format for a batch of encrypted points (e.g. a client upload).
+ *  header:     magic "EKMP" | version | number of points | DIM | BIT_SIZE | CID_BIT_SIZE  (all int64, but the magic)
+ *  per point:  id (int64) | CID_BIT_SIZE cid bits | DIM x BIT_SIZE coordinate bits
+ *  every bit is a ciphertext written with helib::Ctxt::writeTo.
+ *  the id is the one the point had in the writing process - informational only, a read point gets a fresh id.
+ * @note a file is only readable with the public key (i.e. the KeysServer) it was encrypted with,
+ *  and by a build with the same DIM, BIT_SIZE and CID_BIT_SIZE.
+ * */
+class PointFile {
+public:
+    static void write(const std::vector<Point> &points, const std::string &filename);
+
+    /**
+     * @brief stream the points of a file - the file is memory-mapped,
+     *  and every ciphertext is read straight from the mapping into its place in the point.
+     * @param onPoint called for each point, in file order
+     * @returns the number of points read
+     * @throws std::runtime_error if the file can't be mapped, or doesn't match this build
+     * */
+    static long read(const std::string &filename,
+                     const helib::PubKey &public_key,
+                     const std::function<void(Point &&)> &onPoint);
+
+    /**
+     * @brief read all the points of a file
+     * @return std::vector<Point>
+     * */
+    static std::vector<Point> read(const std::string &filename, const helib::PubKey &public_key);
+
+private:
+    static constexpr char MAGIC[4] = {'E', 'K', 'M', 'P'};
+    static constexpr int64_t VERSION = 1;
+};
+
+
+#endif //ENCRYPTEDKMEANS_POINTFILE_H
@@ -1,53 +1,197 @@
-//#include <vector>
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <numeric>
+#include <random>
 #include <sstream>
 #include <string>
 
 #include "run1meancore.h"
-//using namespace std;
 
-//void toCSV(vector<vector<double>> P, int n, int d, string file);
-//
-//vector<vector<double>> & parseCSV(string file);
+/*
+ * Geometry (src/coreset/utils.py)
+ * */
 
-#include <ctime>
-#include <iomanip> // for timestamp = put_time
+//  angles of p - all between 0 and pi, except the last one, which is between 0 and 2pi
+static vector<double> cartesianToPolar(const vector<double> &p) {
+    const int d = p.size();
+    vector<double> angles(d - 1, 0);
+    for (int i = 0; i < d - 1; ++i) {
+        double norm = 0;
+        bool isZero = true;     //  the remaining coordinates are 0 - the angle is ambiguous, we choose 0
+        for (int j = i; j < d; ++j) {
+            norm += p[j] * p[j];
+            isZero &= std::abs(p[j]) <= 1e-8;
+        }
+        if (!isZero) angles[i] = std::acos(std::clamp(p[i] / std::sqrt(norm), -1.0, 1.0));
+    }
+    if (std::round(p[d - 1] * 1e8) / 1e8 < 0) angles[d - 2] = 2 * M_PI - angles[d - 2];
+    return angles;
+}
+
+//  the unit vector the angles represent
+static vector<double> polarToCartesian(const vector<double> &angles) {
+    const int d = angles.size() + 1;
+    vector<double> p(d);
+    double sinProduct = 1;
+    for (int i = 0; i < d; ++i) {
+        p[i] = sinProduct * (i < d - 1 ? std::cos(angles[i]) : 1);
+        if (i < d - 1) sinProduct *= std::sin(angles[i]);
+    }
+    return p;
+}
+
+static double dot(const vector<double> &a, const vector<double> &b) {
+    return std::inner_product(a.begin(), a.end(), b.begin(), 0.0);
+}
+
+static double logn(double base, double x) {
+    return std::log(x) / std::log(base);
+}
+
+/*
+ * The protocol (src/coreset/client.py, src/coreset/server.py, src/coreset/simulator.py)
+ * */
+
+static thread_local std::mt19937 coresetRandomEngine{std::random_device{}()};
+
+//  the noise a client adds to every entry it sends
+static void addNoise(vector<double> &v, double scale, int n, bool isPrivate) {
+    if (!isPrivate) return;
+    std::normal_distribution<double> noise(0, scale / std::sqrt(n));
+    for (double &x: v) x += noise(coresetRandomEngine);
+}
+
+//  the sum of what all the clients send (entry-wise)
+static void accumulate(vector<double> &sum, const vector<double> &v) {
+    for (size_t i = 0; i < sum.size(); ++i) sum[i] += v[i];
+}
+
+//  a client's line - the direction (rounded to a multiple of teta) of its point from the collective mean
+struct CoresetClient {
+    long lineNum = 0;
+    double projection = 0;
+
+    CoresetClient(const vector<double> &p, const vector<double> &collectiveMean, double teta, long lineAmnt) {
+        const int d = p.size();
+        vector<double> normalizedP(d);
+        for (int i = 0; i < d; ++i) normalizedP[i] = p[i] - collectiveMean[i];
+
+        vector<double> line = cartesianToPolar(normalizedP);
+        bool isAbovePi = false;
+        for (double &angle: line) {
+            angle = std::fmod(teta * std::round(angle / teta), 2 * M_PI);
+            isAbovePi |= angle >= M_PI;
+        }
+        if (isAbovePi) line[0] = std::fmod(line[0] + M_PI, 2 * M_PI);
 
-//inline vector<vector<double>> & runCoreset(vector<vector<double>> & P, int n, int d, double eps,
-//        double alpha = 1, double delta = 0.1, bool isPrivate = true, int security = 1024){}
+        const vector<double> direction = polarToCartesian(line);
+        //  easiest way to translate a line with angles > 180, to the same line with all angles < 180
+        line = cartesianToPolar(direction);
 
-vector<vector<double>> &runCoreset(std::vector<vector<double> > &P, int n, int d, double eps,
+        long flatter = 1;
+        for (double angle: line) {
+            lineNum += flatter * std::lround(angle / teta);
+            flatter *= lineAmnt;
+        }
+        projection = dot(direction, normalizedP);
+    }
+};
+
+vector<vector<double> > runCoreset(const vector<vector<double> > &P, int n, int d, double eps,
                                    double alpha, double delta, bool isPrivate, int security) {
-    toCSV(P, n, d, "points.csv");
-    //    string commandLS ="ls -l */*"; system(commandLS.c_str());
-
-    // CT for coreset.csv result for multiple iterations
-    auto t = time(nullptr);
-    auto tm = *localtime(&t);
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%Y_%m_%d_%H_%M_%S");
-    string timestamp = oss.str();
-//    oss.flush();
-        oss.clear();
-    string filename = "io/" + timestamp + "_coreset.csv";
-
-    string command =
-            //            "/home/fares/.virtualenvs/kmeans/bin/python -m impl.coreset.simulator points.csv "
-//            "/home/karina/CLionProjects/EncryptedKMeans/venv/bin/python3.7 -m src.coreset.simulator points.csv "
-//            "/home/karina/CLionProjects/EncryptedKMeans/venv/bin/python3.7 -m src.coreset.simulator points.csv "
-            "venv/bin/python3 -m src.coreset.simulator points.csv "
-            + to_string(eps) + " " + to_string(alpha) + " " + to_string(delta) +
-            " -s " + to_string(security) + (isPrivate ? "" : " -n") + " -f" + filename;
-    system(command.c_str());
-//    string commandl = "ls -l ";
-//    system(commandl.c_str());
-//    string commandl2 = "pwd ";
-//    system(commandl2.c_str());
-    return parseCSV(filename);
-//    return parseCSV("coreset.csv");
+    vector<vector<double> > coreset;
+    if (0 == n) return coreset;
+
+    const double teta = M_PI / std::ceil(M_PI / (2 * eps));
+    const long lineAmnt = std::lround(M_PI / teta);
+    const long linesNum = std::lround(std::pow(lineAmnt, d - 1));
+
+    //  round 1 - the collective mean
+    vector<double> collectiveMean(d, 0);
+    for (int j = 0; j < n; ++j) {
+        vector<double> toSend(P[j].begin(), P[j].begin() + d);
+        for (double &x: toSend) x /= n;
+        addNoise(toSend, d / (n * alpha), n, isPrivate);
+        accumulate(collectiveMean, toSend);
+    }
+
+    //  round 2 - the mean of the projections on every line (and the number of points on it)
+    vector<CoresetClient> clients;
+    clients.reserve(n);
+    vector<double> linesMeansVector(2 * linesNum, 0);
+    for (int j = 0; j < n; ++j) {
+        clients.emplace_back(P[j], collectiveMean, teta, lineAmnt);
+        vector<double> encoded(2 * linesNum, 0);
+        encoded.at(2 * clients.back().lineNum) = clients.back().projection;
+        encoded.at(2 * clients.back().lineNum + 1) = 1;
+        addNoise(encoded, 1 / alpha, n, isPrivate);
+        accumulate(linesMeansVector, encoded);
+    }
+
+    vector<double> means(linesNum), n0(linesNum), r0(linesNum);
+    vector<long> t(linesNum);
+    for (long l = 0; l < linesNum; ++l) {
+        const double s = linesMeansVector[2 * l], count = linesMeansVector[2 * l + 1];
+        means[l] = count != 0 ? s / count : 0;
+        n0[l] = std::max(count, std::log(1 / delta) / alpha);
+        r0[l] = std::log(1 / delta) / (alpha * n0[l]);
+        t[l] = long(std::ceil(logn(1 + eps, 1 / r0[l])));
+    }
+    const long maxT = *std::max_element(t.begin(), t.end());
+    const long intervalAmnt = 2 * maxT + 3;
+
+    //  round 3 - the histogram of the points over the intervals of the lines
+    vector<double> weightVector(intervalAmnt * linesNum, 0);
+    for (const CoresetClient &client: clients) {
+        const long l = client.lineNum;
+        const double normalizedProjection = client.projection - means[l];
+        const double absProjection = std::abs(normalizedProjection);
+        long absInterval;
+        if (absProjection < r0[l]) absInterval = 0;
+        else if (absProjection > 1) absInterval = t[l];
+        else absInterval = std::min(std::lround(logn(1 + eps, absProjection / r0[l])), t[l]);
+        const long interval = normalizedProjection > 0 ? absInterval : maxT + 1 + absInterval;
+
+        vector<double> encoded(weightVector.size(), 0);
+        encoded.at(l * intervalAmnt + interval) = 1;
+        addNoise(encoded, 1 / alpha, n, isPrivate);
+        accumulate(weightVector, encoded);
+    }
+
+    //  decode the weights into the coreset
+    for (long i = 0; i < long(weightVector.size()); ++i) {
+        const long l = i / intervalAmnt, interval = i % intervalAmnt;
+        double q, w;
+        if (interval == intervalAmnt - 1) {
+            q = 0;
+            w = -std::accumulate(weightVector.begin() + l * intervalAmnt, weightVector.begin() + i, 0.0)
+                + weightVector[i] + n0[l];
+        } else if (interval % (maxT + 1) > t[l]) continue;
+        else if (interval < maxT + 1) {
+            q = std::min(r0[l] * std::pow(1 + eps, interval), 1.0);
+            w = weightVector[i];
+        } else {
+            q = -std::min(r0[l] * std::pow(1 + eps, interval - (maxT + 1)), 1.0);
+            w = weightVector[i];
+        }
+
+        vector<double> line(d - 1);
+        long lineIndex = l;
+        for (double &angle: line) {
+            angle = (lineIndex % lineAmnt) * teta;
+            lineIndex /= lineAmnt;
+        }
+        vector<double> row = polarToCartesian(line);
+        for (int k = 0; k < d; ++k) row[k] = row[k] * (q + means[l]) + collectiveMean[k];
+        row.push_back(w);
+        coreset.push_back(std::move(row));
+    }
+
+    return coreset;
 }
 
-void toCSV(vector<vector<double>> P, int n, int d, string file) {
+void toCSV(const vector<vector<double>> &P, int n, int d, const string &file) {
     ofstream fout;
     fout.open(file);
     for (int i = 0; i < n; i++) {
@@ -58,8 +202,7 @@ void toCSV(vector<vector<double>> P, int n, int d, string file) {
     fout.close();
 }
 
-// TODO fix bug
-vector<vector<double>> &parseCSV(string file) {
+vector<vector<double>> parseCSV(const string &file) {
     ifstream data;
     data.open(file);
     string line;
@@ -77,4 +220,3 @@ vector<vector<double>> &parseCSV(string file) {
     data.close();
     return parsedCsv;
 }
-
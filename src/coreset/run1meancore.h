@@ -10,13 +10,29 @@
 
 using namespace std;
 
-void toCSV(vector<vector<double> > P, int n, int d, string file);
-
-vector<vector<double> > & parseCSV(string file);
-
-//inline vector<vector<double> > & runCoreset(
- vector<vector<double> > & runCoreset(
-        vector<vector<double> > & P, int n, int d, double eps,
+void toCSV(const vector<vector<double> > &P, int n, int d, const string &file);
+
+vector<vector<double> > parseCSV(const string &file);
+
+/**
+ * @brief the 1-mean coreset of the points (a C++ port of src/coreset/simulator.py).
+ *  every point is a client, and the (noised) sums of the 3 rounds of the protocol are computed in-process:
+ *  1. the collective mean  2. the mean of the points on every line (direction) from it
+ *  3. the histogram of the points over the intervals of every line
+ * @param P the points (n points, d coordinates each)
+ * @param eps multiplicative error
+ * @param alpha privacy parameter
+ * @param delta failure probability
+ * @param isPrivate add gaussian noise to everything the clients send
+ * @param security kept for compatibility with the simulator's command line.
+ *  there, the clients' vectors are summed under Paillier encryption (0 - no encryption),
+ *  which hides them from the simulated server but doesn't change the decrypted sums.
+ * @note reentrant (each thread has its own random engine), so groups can be run in parallel
+ * @returns the weighted coreset - every row is a point (d coordinates) followed by its weight
+ * @return vector<vector<double> >
+ * */
+vector<vector<double> > runCoreset(
+        const vector<vector<double> > &P, int n, int d, double eps,
         double alpha = 1, double delta = 0.1,
         bool isPrivate = true, int security = 1024);
 
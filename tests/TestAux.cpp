@@ -913,11 +913,77 @@ void TestAux::testMultithreading() {
 
 }
 
+#include "utils/ThreadPool.h"
+
+long FibWithSubTasks(ThreadPool &threadPool, int n) {
+    if (n < 10) return n < 2 ? n : FibWithSubTasks(threadPool, n - 1) + FibWithSubTasks(threadPool, n - 2);
+    std::future<long> future = threadPool.submit(FibWithSubTasks, std::ref(threadPool), n - 1);
+    long fib = FibWithSubTasks(threadPool, n - 2);
+    return fib + threadPool.wait(future);
+}
+
+void TestAux::testThreadPool() {
+    cout << " ------ testThreadPool ------ " << endl << endl;
+    ThreadPool threadPool(NUMBER_OF_THREADS);
+    assert(threadPool.size() == NUMBER_OF_THREADS);
+
+    //  many more tasks than workers
+    std::vector<unsigned int> counts(10000, 0);
+    std::vector<std::future<void> > futures;
+    for (unsigned int i = 0; i < counts.size(); ++i)
+        futures.push_back(threadPool.submit([&counts, i] { ++counts[i]; }));
+    threadPool.wait(futures);
+    for (unsigned int count: counts) assert(1 == count);
+
+    //  tasks returning values
+    std::future<std::vector<unsigned int> >
+            primes = threadPool.submit([] {
+        std::vector<unsigned int> primeVec;
+        FindPrimes(3, 1000, primeVec);
+        return primeVec;
+    });
+    printNameVal(threadPool.wait(primes).size());
+
+    //  nested tasks (submitting and waiting from inside a worker must not deadlock)
+    auto t0_fib = CLOCK::now();
+    long fib = FibWithSubTasks(threadPool, 25);
+    printNameVal(fib);
+    assert(75025 == fib);
+    cout << printDuration(t0_fib, "FibWithSubTasks");
+
+    cout << " ------ testThreadPool finished ------ " << endl << endl;
+}
+
 #include <sstream>
 #include <string>
 
 #include "src/coreset/run1meancore.h"
 
+void TestAux::testRunCoreset() {
+    cout << " ------ testRunCoreset ------ " << endl << endl;
+    std::uniform_real_distribution<double> coordinate(0, range_lim);
+    std::vector<std::vector<double> > P(NUMBER_OF_POINTS, std::vector<double>(DIM));
+    for (std::vector<double> &p: P) for (double &x: p) x = coordinate(mt);
+
+    for (bool isPrivate: {false, true}) {
+        auto t0_coreset = CLOCK::now();
+        const std::vector<std::vector<double> > coreset = runCoreset(P, P.size(), DIM, EPSILON, 1, 0.1, isPrivate);
+        printDuration(t0_coreset, isPrivate ? "runCoreset (private)" : "runCoreset");
+
+        double totalWeight = 0;
+        for (const std::vector<double> &row: coreset) {
+            assert(DIM + 1 == row.size());   //  a point and its weight
+            totalWeight += row.back();
+        }
+        printNameVal(coreset.size());
+        printNameVal(totalWeight);
+        //  with no noise, every point is counted (a line with fewer than log(1/delta)/alpha points is padded)
+        if (!isPrivate) assert(P.size() <= totalWeight + 1e-6);
+    }
+
+    cout << " ------ testRunCoreset finished ------ " << endl << endl;
+}
+
 void TestAux::testPythonRun() {
     string command;
     //    string commandLS ="ls -l */*"; system(commandLS.c_str());
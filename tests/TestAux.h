@@ -16,8 +16,12 @@ public:
 
     static void testMultithreading();
 
+    static void testThreadPool();
+
     static void testPythonRun();
 
+    static void testRunCoreset();
+
     static void testComparison_diffCtxtRepresentation();
 
     static void testComparison_diffCtxtRepresentation_BGVPackedArithmetics();
@@ -41,6 +41,30 @@ void TestClient::testDecryptCoordinates() {
 }
 
 
+void TestClient::testEncryptPoints() {
+    cout << " ------ testEncryptPoints ------ " << endl;
+    KeysServer keysServer;
+    ThreadPool threadPool(NUMBER_OF_THREADS);
+
+    std::vector<DecryptedPoint> coordinates(NUMBER_OF_POINTS, DecryptedPoint(DIM));
+    for (DecryptedPoint &pPoint: coordinates)
+        for (long &coor: pPoint) coor = randomLongInRange(mt);
+
+    Client client(keysServer);
+    auto t0_encryptPoints = CLOCK::now();
+    client.encryptPoints(coordinates, threadPool);
+    printDuration(t0_encryptPoints, "encryptPoints");
+
+    assert(coordinates.size() == client.getPoints().size());
+    for (int i = 0; i < coordinates.size(); ++i) {
+        assert(coordinates[i] == client.decryptCoordinate(i));
+        if (i) assert(client.getPoints()[i - 1].id < client.getPoints()[i].id);
+    }
+
+    cout << " ------ testEncryptPoints finished ------ " << endl << endl;
+}
+
+
 void TestClient::testEncryptScratchPoint() {
     cout << " ------ testEncryptScratchPoint ------ " << endl << endl;
     KeysServer keysServer;
@@ -1,3 +1,5 @@
+#include <numeric>
+#include <set>
 
 #include <src/coreset/run1meancore.h>
 #include "TestDataServer.h"
@@ -80,6 +82,109 @@ void TestDataServer::testRetrievePoints_Threads() {
     cout << " ------ testRetrievePoints_Threads finished ------ " << endl << endl;
 }
 
+void TestDataServer::testRetrievePoints_FromFiles() {
+    cout << " ------ testRetrievePoints_FromFiles ------ " << endl << endl;
+    KeysServer keysServer;
+    DataServer dataServer(keysServer);
+
+    //  every client uploads its points as a file
+    std::vector<Client> clients = generateDataClients(keysServer);
+    std::vector<std::string> filenames;
+    for (const Client &client: clients) {
+        filenames.push_back(IO_DIR + "client_" + std::to_string(filenames.size()) + ".points");
+        client.writePoints(filenames.back());
+    }
+
+    std::vector<Point> points = dataServer.retrievePoints(clients);
+    std::vector<Point> points_fromFiles = dataServer.retrievePoints_FromFiles(filenames);
+    assert(points.size() == points_fromFiles.size());
+
+    //  same points (the files are read in parallel, so not in the same order),
+    //  with fresh ids - the ids in the files are only informational
+    std::vector<DecryptedPoint> expected = keysServer.decryptPoints(points);
+    std::vector<DecryptedPoint> actual = keysServer.decryptPoints(points_fromFiles);
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    assert(expected == actual);
+    std::set<long> ids;
+    for (const Point &point: points) ids.insert(point.id);
+    for (const Point &point: points_fromFiles) assert(ids.insert(point.id).second);
+
+    cout << " --- Points From Files ---" << endl;
+    printPoints(points_fromFiles, keysServer);
+    cout << " --- --- --- --- ---" << endl;
+
+    cout << " ------ testRetrievePoints_FromFiles finished ------ " << endl << endl;
+}
+
+void TestDataServer::testStreamingChunks() {
+    cout << " ------ testStreamingChunks ------ " << endl << endl;
+    KeysServer keysServer;
+    DataServer dataServer(keysServer);
+
+    std::vector<Client> clients = generateDataClients(keysServer);
+    std::vector<std::string> filenames;
+    long numOfPoints = 0;
+    for (const Client &client: clients) {
+        filenames.push_back(IO_DIR + "client_" + std::to_string(filenames.size()) + ".points");
+        client.writePoints(filenames.back());
+        numOfPoints += client.getPoints().size();
+    }
+
+    //  as main does in streaming mode - every chunk is loaded, runs a whole iteration, and is forgotten.
+    //  a chunk runs once the next one has the points of its reps, so a short tail is merged into the last one
+    const long minChunkSize = std::pow(1 / EPSILON, DIM);
+    const long chunkSize = std::max(minChunkSize, numOfPoints / 2);
+    std::vector<Point> chunk;
+    long chunks = 0, chunkedPoints = 0;
+    auto runChunk = [&]() {
+        assert(minChunkSize <= chunk.size());
+        chunkedPoints += chunk.size();
+        dataServer.clearForNextIteration(chunk);
+        assert(dataServer.retrievedPoints.size() == chunk.size());
+
+        const std::vector<std::vector<Point> > randomPoints = dataServer.pickRandomPoints(chunk);
+        const CmpDict &cmpDict = dataServer.createCmpDict_WithThreads(chunk, randomPoints);
+        std::map<int, std::vector<Slice> > epsNet =
+                dataServer.splitIntoEpsNet_WithThreads(chunk, randomPoints, cmpDict);
+        assert(!epsNet[DIM - 1].empty());
+        std::vector<Point> means =
+                dataServer.collectMeans(dataServer.calculateSlicesMeans_WithThreads(epsNet[DIM - 1]));
+        const std::vector<std::tuple<Point, Point, EncryptedNum> > minDistanceTuples =
+                dataServer.collectMinimalDistancesAndClosestPoints_WithThreads(chunk, means);
+        assert(minDistanceTuples.size() == chunk.size());
+        EncryptedNum threshold = dataServer.calculateThreshold(minDistanceTuples, 0, chunk.size());
+        auto groups = dataServer.choosePointsByDistance_WithThreads(minDistanceTuples, means, threshold);
+        assert(std::get<1>(groups).size() == chunk.size());    //  every point is in the leftover (masked, or not)
+
+        chunk.clear();
+        dataServer.clearForNextChunk();
+        assert(dataServer.retrievedPoints.empty());
+        ++chunks;
+    };
+    for (const std::string &filename: filenames)
+        PointFile::read(filename, keysServer.getPublicKey(), [&](Point &&point) {
+            chunk.push_back(std::move(point));
+            if (chunkSize + minChunkSize == chunk.size()) {
+                std::vector<Point> next(std::make_move_iterator(chunk.begin() + chunkSize),
+                                        std::make_move_iterator(chunk.end()));
+                chunk.erase(chunk.begin() + chunkSize, chunk.end());
+                runChunk();
+                chunk = std::move(next);
+            }
+        });
+    if (!chunk.empty()) runChunk();
+    assert(numOfPoints == chunkedPoints);
+    assert(2 <= chunks || numOfPoints < chunkSize + minChunkSize);
+
+    //  too few points for the reps of all the dims - none are picked (main passes such a set through)
+    std::vector<Point> few(dataServer.retrievePoints(clients));
+    few.erase(few.begin() + std::min<long>(few.size(), minChunkSize - 1), few.end());
+    for (const std::vector<Point> &reps: dataServer.pickRandomPoints(few)) assert(reps.empty());
+
+    cout << " ------ testStreamingChunks finished ------ " << endl << endl;
+}
+
 void TestDataServer::testPickRandomPoints() {
     cout << " ------ testPickRandomPoints ------ " << endl << endl;
     KeysServer keysServer;
@@ -125,39 +230,35 @@ void TestDataServer::testCreateCmpDict() {
     for (auto vec :randomPoints) printPoints(vec, keysServer);
     cout << " --- --- --- --- ---" << endl;
 
-    std::vector<
-            std::unordered_map<
-                    const Point,
-                    std::unordered_map<
-                            const Point,
-                            helib::Ctxt> > >
+    CmpDict
             cmp = dataServer.createCmpDict(points, randomPoints);
 
     cout << "The Dictionary: " << endl;
     for (short dim = 0; dim < DIM; ++dim) {
         cout << "    ======   ";
         printNameVal(dim);// << " ======" << endl;
-        for (auto const&[point, map] : cmp[dim]) {
-            printPoint(point, keysServer);
+        for (const Point &rep: randomPoints[dim]) {
+            printPoint(rep, keysServer);
             cout << endl;
 
-            long p1c = keysServer.decryptNum(point[dim]);
+            long p1c = keysServer.decryptNum(rep[dim]);
 
-            for (auto const&[point2, val]: map) {
+            for (const Point &point: points) {
 
-                long p2c = keysServer.decryptNum(point2[dim]);
+                long p2c = keysServer.decryptNum(point[dim]);
 
-                long pVal = keysServer.decryptCtxt(val);
+                long pVal = keysServer.decryptCtxt(cmp.isBigger(dim, rep, point));
                 assert(pVal == (p1c > p2c) || pVal == (p1c == p2c));
+                pVal = keysServer.decryptCtxt(cmp.isBigger(dim, point, rep));
+                assert(pVal == (p2c > p1c) || pVal == (p1c == p2c));
 
-                printPoint(point2, keysServer);
+                printPoint(point, keysServer);
                 printNameVal(pVal);
 
             }
-            printNameVal(map.size());
             cout << " --- --- ---" << endl;
         }
-        printNameVal(cmp[dim].size());
+        printNameVal(cmp.numOfReps(dim));
         cout << " === === ===" << endl;
     }
 
@@ -193,12 +294,7 @@ void TestDataServer::testCreateCmpDict_Threads() {
     for (const auto &vec :randomPoints) printPoints(vec, keysServer);
     cout << " --- --- --- --- ---" << endl;
 
-    std::vector<
-            std::unordered_map<
-                    const Point,
-                    std::unordered_map<
-                            const Point,
-                            helib::Ctxt> > >
+    CmpDict
             cmp = dataServer.createCmpDict(points, randomPoints);
     dataServer.createCmpDict_WithThreads(points, randomPoints, NUMBER_OF_THREADS);
 
@@ -206,27 +302,28 @@ void TestDataServer::testCreateCmpDict_Threads() {
     for (short dim = 0; dim < DIM; ++dim) {
         cout << "    ======   ";
         printNameVal(dim);// << " ======" << endl;
-        for (auto const&[point, map] : cmp[dim]) {
-            printPoint(point, keysServer);
+        for (const Point &rep: randomPoints[dim]) {
+            printPoint(rep, keysServer);
             cout << endl;
 
-            long p1c = keysServer.decryptNum(point[dim]);
+            long p1c = keysServer.decryptNum(rep[dim]);
 
-            for (auto const&[point2, val]: map) {
+            for (const Point &point: points) {
 
-                long p2c = keysServer.decryptNum(point2[dim]);
+                long p2c = keysServer.decryptNum(point[dim]);
 
-                long pVal = keysServer.decryptCtxt(val);
+                long pVal = keysServer.decryptCtxt(cmp.isBigger(dim, rep, point));
                 assert(pVal == (p1c > p2c) || pVal == (p1c == p2c));
+                pVal = keysServer.decryptCtxt(cmp.isBigger(dim, point, rep));
+                assert(pVal == (p2c > p1c) || pVal == (p1c == p2c));
 
-                printPoint(point2, keysServer);
+                printPoint(point, keysServer);
                 printNameVal(pVal);
 
             }
-            printNameVal(map.size());
             cout << " --- --- ---" << endl;
         }
-        printNameVal(cmp[dim].size());
+        printNameVal(cmp.numOfReps(dim));
         cout << " === === ===" << endl;
     }
 
@@ -234,33 +331,85 @@ void TestDataServer::testCreateCmpDict_Threads() {
     for (short dim = 0; dim < DIM; ++dim) {
         cout << "    ======   ";
         printNameVal(dim);// << " ======" << endl;
-        for (auto const&[point, map] : dataServer.cmpDict[dim]) {
-            printPoint(point, keysServer);
+        for (const Point &rep: randomPoints[dim]) {
+            printPoint(rep, keysServer);
             cout << endl;
 
-            long p1c = keysServer.decryptNum(point[dim]);
+            long p1c = keysServer.decryptNum(rep[dim]);
 
-            for (auto const&[point2, val]: map) {
+            for (const Point &point: points) {
 
-                long p2c = keysServer.decryptNum(point2[dim]);
+                long p2c = keysServer.decryptNum(point[dim]);
 
-                long pVal = keysServer.decryptCtxt(val);
+                long pVal = keysServer.decryptCtxt(dataServer.cmpDict.isBigger(dim, rep, point));
                 assert(pVal == (p1c > p2c) || pVal == (p1c == p2c));
+                pVal = keysServer.decryptCtxt(dataServer.cmpDict.isBigger(dim, point, rep));
+                assert(pVal == (p2c > p1c) || pVal == (p1c == p2c));
 
-                printPoint(point2, keysServer);
+                printPoint(point, keysServer);
                 printNameVal(pVal);
 
             }
-            printNameVal(map.size());
             cout << " --- --- ---" << endl;
         }
-        printNameVal(dataServer.cmpDict[dim].size());
+        printNameVal(dataServer.cmpDict.numOfReps(dim));
         cout << " === === ===" << endl;
     }
 
+    //  every pair of reps is compared by one of their rows, and mirrored to the other
+    for (short dim = 0; dim < DIM; ++dim)
+        for (const Point &rep1: randomPoints[dim])
+            for (const Point &rep2: randomPoints[dim]) {
+                if (rep1 == rep2) continue;
+                long r1c = keysServer.decryptNum(rep1[dim]);
+                long r2c = keysServer.decryptNum(rep2[dim]);
+                assert(keysServer.decryptCtxt(dataServer.cmpDict.isBigger(dim, rep1, rep2)) == (r1c > r2c));
+                assert(keysServer.decryptCtxt(cmp.isBigger(dim, rep1, rep2)) == (r1c > r2c));
+            }
+
     cout << " ------ testCreateCmpDict_Threads finished ------ " << endl << endl;
 }
 
+void TestDataServer::testCreateCmpDict_Incremental() {
+    cout << " ------ testCreateCmpDict_Incremental ------ " << endl << endl;
+    KeysServer keysServer;
+    DataServer dataServer(keysServer);
+
+    std::vector<Client> clients = generateDataClients(keysServer);
+    std::vector<Point> points = dataServer.retrievePoints_WithThreads(clients);
+    std::vector<std::vector<Point>> randomPoints = dataServer.pickRandomPoints(points);
+    dataServer.createCmpDict_WithThreads(points, randomPoints);
+
+    assert(0 < dataServer.cmpDict.numOfCached());
+
+    //  mask about half of the points, as choosePointsByDistance does with the farthest points
+    for (const Point &point: points) {
+        CBit bit = keysServer.encryptCtxt(randomLongInRange(mt) % 2);
+        dataServer.farthest.emplace_back(point * bit, bit);
+    }
+    std::vector<Point> leftover;
+    for (auto const &[point, isIn]: dataServer.farthest) leftover.push_back(point);
+    dataServer.clearForNextIteration(leftover);
+    //  the reps of the next iteration are new sorted copies (new ids) - no comparison is kept for them
+    assert(0 == dataServer.cmpDict.numOfCached());
+
+    //  the next iteration: its own (sorted) reps of the masked points, all compared from scratch
+    const std::vector<std::vector<Point> > &nextReps = dataServer.pickRandomPoints(dataServer.retrievedPoints);
+    const CmpDict &cmpDict = dataServer.createCmpDict_WithThreads(dataServer.retrievedPoints, nextReps);
+
+    for (short dim = 0; dim < DIM; ++dim)
+        for (const Point &rep: nextReps[dim]) {
+            long p1c = keysServer.decryptNum(rep[dim]);
+            for (const Point &point: dataServer.retrievedPoints) {
+                long p2c = keysServer.decryptNum(point[dim]);
+                assert(keysServer.decryptCtxt(cmpDict.isBigger(dim, rep, point)) == (p1c > p2c));
+                assert(keysServer.decryptCtxt(cmpDict.isBigger(dim, point, rep)) == (p2c > p1c));
+            }
+        }
+
+    cout << " ------ testCreateCmpDict_Incremental finished ------ " << endl << endl;
+}
+
 void TestDataServer::testSplitIntoEpsNet() {
     cout << " ------ testSplitIntoEpsNet ------ " << endl;// << endl;
     KeysServer keysServer;
@@ -273,12 +422,7 @@ void TestDataServer::testSplitIntoEpsNet() {
     std::vector<std::vector<Point>>
             randomPoints = dataServer.pickRandomPoints(points);//, 1 / EPSILON);
 
-    std::vector<
-            std::unordered_map<
-                    const Point,
-                    std::unordered_map<
-                            const Point,
-                            helib::Ctxt> > >
+    CmpDict
             cmpDict = dataServer.createCmpDict(points, randomPoints);
 
     cout << " --- All Points  ---" << endl;
@@ -293,17 +437,16 @@ void TestDataServer::testSplitIntoEpsNet() {
     for (int dim = 0; dim < DIM; ++dim) {
         cout << "    ======   ";
         printNameVal(dim);// << " ======" << endl;
-        for (auto const&[point, map] : cmpDict[dim]) {
-            printPoint(point, keysServer);
+        for (const Point &rep: randomPoints[dim]) {
+            printPoint(rep, keysServer);
             cout << endl;
-            for (auto const&[point2, val]: map) {
-                printPoint(point2, keysServer);
-                printNameVal(keysServer.decryptCtxt(val));
+            for (const Point &point: points) {
+                printPoint(point, keysServer);
+                printNameVal(keysServer.decryptCtxt(cmpDict.isBigger(dim, rep, point)));
             }
-            printNameVal(map.size());
             cout << " --- --- ---" << endl;
         }
-        printNameVal(cmpDict[dim].size());
+        printNameVal(cmpDict.numOfReps(dim));
         cout << " === === ===" << endl;
     }
 
@@ -332,12 +475,7 @@ void TestDataServer::testSplitIntoEpsNet_WithThreads() {
 
     std::vector<std::vector<Point>> randomPoints = dataServer.pickRandomPoints(points);
 
-    std::vector<
-            std::unordered_map<
-                    const Point,
-                    std::unordered_map<
-                            const Point,
-                            helib::Ctxt> > >
+    CmpDict
             cmpDict = dataServer.createCmpDict(points, randomPoints);
     dataServer.createCmpDict_WithThreads(points, randomPoints, NUMBER_OF_THREADS);
 
@@ -354,17 +492,16 @@ void TestDataServer::testSplitIntoEpsNet_WithThreads() {
     for (int dim = 0; dim < DIM; ++dim) {
         cout << "    ======   ";
         printNameVal(dim);// << " ======" << endl;
-        for (auto const&[point, map] : cmpDict[dim]) {
-            printPoint(point, keysServer);
+        for (const Point &rep: randomPoints[dim]) {
+            printPoint(rep, keysServer);
             cout << endl;
-            for (auto const&[point2, val]: map) {
-                printPoint(point2, keysServer);
-                printNameVal(keysServer.decryptCtxt(val));
+            for (const Point &point: points) {
+                printPoint(point, keysServer);
+                printNameVal(keysServer.decryptCtxt(cmpDict.isBigger(dim, rep, point)));
             }
-            printNameVal(map.size());
             cout << " --- --- ---" << endl;
         }
-        printNameVal(cmpDict[dim].size());
+        printNameVal(cmpDict.numOfReps(dim));
         cout << " === === ===" << endl;
     }
 
@@ -389,10 +526,74 @@ void TestDataServer::testSplitIntoEpsNet_WithThreads() {
         cout << endl;
     }
 
+    //  every task of the split fills its own place - the same slices, in the same order, as the serial split
+    for (int dim = 0; dim < DIM; ++dim) {
+        assert(slices[dim].size() == slices_Threads[dim].size());
+        for (long i = 0; i < slices[dim].size(); ++i)
+            assert(keysServer.decryptPoints(slices[dim][i].points)
+                   == keysServer.decryptPoints(slices_Threads[dim][i].points));
+    }
+
     cout << " ------ testSplitIntoEpsNet_WithThreads finished ------ " << endl << endl;
 
 }
 
+void TestDataServer::testSplitIntoEpsNet_SortedReps() {
+    cout << " ------ testSplitIntoEpsNet_SortedReps ------ " << endl;
+    if (DIM < 2) {
+        //  a rep is checked against the rep of the previous dim only from the 2nd dim on
+        cout << " ------ testSplitIntoEpsNet_SortedReps skipped (DIM < 2) ------ " << endl << endl;
+        return;
+    }
+    KeysServer keysServer;
+    DataServer dataServer(keysServer);
+
+    std::vector<Client> clients = generateDataClients(keysServer);
+    std::vector<Point> points = dataServer.retrievePoints_WithThreads(clients);
+    //  the reps are sorted copies with fresh ids - a rep of 2 dims is compared with itself by value
+    std::vector<std::vector<Point> > randomPoints = dataServer.pickRandomPoints(points);
+    const CmpDict &cmpDict = dataServer.createCmpDict_WithThreads(points, randomPoints, NUMBER_OF_THREADS);
+
+    std::map<int, std::vector<Slice> >
+            slices = dataServer.splitIntoEpsNet_WithThreads(points, randomPoints, cmpDict);
+
+    std::vector<std::vector<long> > decPoints = keysServer.decryptPoints(points);
+    std::vector<std::vector<std::vector<long> > > decReps(DIM);
+    for (int dim = 0; dim < DIM; ++dim) decReps[dim] = keysServer.decryptPoints(randomPoints[dim]);
+    //  the tiny point (0) is the smallest rep
+    const long tiny = decReps[0].front()[0];
+
+    //  the same split, in the clear: a slice of the last dim is one rep of each dim (the index in mixed radix)
+    assert(slices[DIM - 1].size() == std::accumulate(decReps.begin(), decReps.end(), 1L,
+                                                     [](long product, const std::vector<std::vector<long> > &reps) {
+                                                         return product * long(reps.size());
+                                                     }));
+    for (long index = 0; index < slices[DIM - 1].size(); ++index) {
+        std::vector<long> k(DIM);
+        for (long dim = DIM - 1, rest = index; 0 <= dim; rest /= long(decReps[dim].size()), --dim)
+            k[dim] = rest % long(decReps[dim].size());
+
+        //  every rep is in the slice of the previous one: R <= the base rep, inclusive
+        bool areRepsInSlice = true;
+        for (int dim = 1; dim < DIM; ++dim)
+            areRepsInSlice &= randomPoints[dim][k[dim]].id == randomPoints[dim - 1][k[dim - 1]].id
+                              || decReps[dim][k[dim]][dim - 1] <= decReps[dim - 1][k[dim - 1]][dim - 1];
+
+        const Slice &slice = slices[DIM - 1][index];
+        assert(slice.counter.size() == points.size());
+        for (long i = 0; i < points.size(); ++i) {
+            const std::vector<long> &p = decPoints[i];
+            bool isIn = areRepsInSlice && p[0] > tiny;
+            for (int dim = 0; dim < DIM; ++dim)
+                isIn &= p[dim] <= decReps[dim][k[dim]][dim] && (0 == k[dim] || p[dim] > decReps[dim][k[dim] - 1][dim]);
+            assert(isIn == bool(keysServer.decryptCtxt(slice.counter[i])));
+        }
+    }
+
+    cout << " ------ testSplitIntoEpsNet_SortedReps finished ------ " << endl << endl;
+
+}
+
 void TestDataServer::testCalculateCellMeans() {
     cout << " ------ testCalculateCellMeans ------ " << endl;
     KeysServer keysServer;
@@ -401,7 +602,7 @@ void TestDataServer::testCalculateCellMeans() {
     std::vector<Client> clients = generateDataClients(keysServer);
     std::vector<Point> points = dataServer.retrievePoints(clients);
     std::vector<std::vector<Point> > randomPoints = dataServer.pickRandomPoints(points);
-    std::vector<std::unordered_map<const Point, std::unordered_map<const Point, helib::Ctxt> > >
+    CmpDict
             cmpDict = dataServer.createCmpDict(points, randomPoints);
 
     std::map<int, std::vector<Slice> >
@@ -450,7 +651,7 @@ void TestDataServer::testCalculateCellMeans_WithThreads() {
     std::vector<std::vector<Point> > randomPoints = dataServer.pickRandomPoints(points);
     std::vector<std::vector<Point> > randomPoints_forThreads = dataServer.randomPointsList;
     //  compare dict
-    std::vector<std::unordered_map<const Point, std::unordered_map<const Point, helib::Ctxt> > >
+    CmpDict
             cmpDict = dataServer.createCmpDict(points, randomPoints);
     CmpDict &cmpDict_withThreads = dataServer.createCmpDict_WithThreads(points, randomPoints, NUMBER_OF_THREADS);
     //  EPS net
@@ -533,6 +734,7 @@ void TestDataServer::testGetMinimalDistances() {
         points2.emplace_back(Point(keysServer.getPublicKey(), tempArrs2[i]));
     }
     std::vector<Point> dummyMeans(points2.begin(), points2.begin() + 1 / EPSILON);
+    for (int i = 0; i < dummyMeans.size(); ++i) dummyMeans[i].setCid(i); // cid is the index of the mean
 
     cout << endl << "Points: ";
     printPoints(points, keysServer);
@@ -602,6 +804,7 @@ void TestDataServer::testGetMinimalDistances_WithThreads() {
         points2.emplace_back(Point(keysServer.getPublicKey(), tempArrs2[i]));
     }
     std::vector<Point> dummyMeans(points2.begin(), points2.begin() + DIM);
+    for (int i = 0; i < dummyMeans.size(); ++i) dummyMeans[i].setCid(i); // cid is the index of the mean
 
 
     //  Retrieve expected results
@@ -715,6 +918,120 @@ void TestDataServer::testGetMinimalDistances_WithThreads() {
     cout << " ------ testGetMinimalDistances_WithThreads finished ------ " << endl << endl;
 }
 
+void TestDataServer::testDistanceMatrix() {
+    cout << " ------ testDistanceMatrix ------ " << endl;
+    const KeysServer keysServer;
+    DataServer dataServer(keysServer);
+
+    //  Creating Data
+    int n = NUMBER_OF_POINTS, m = 1 / EPSILON + 2;   //  at least 2 means, for the second closest
+    std::vector<Point> points, means;
+    points.reserve(n);
+    means.reserve(m);
+    long tempArrs[n][DIM], tempArrs2[m][DIM];
+    for (int j = 0; j < m; ++j) {
+        for (int dim = 0; dim < DIM; ++dim) tempArrs2[j][dim] = randomLongInRange(mt);
+        means.emplace_back(Point(keysServer.getPublicKey(), tempArrs2[j]));
+        means.back().setCid(j); // cid is the index of the mean
+    }
+    for (int i = 0; i < n; ++i) {
+        for (int dim = 0; dim < DIM; ++dim) tempArrs[i][dim] = randomLongInRange(mt);
+        points.emplace_back(Point(keysServer.getPublicKey(), tempArrs[i]));
+    }
+
+    //  Calculating Algorithm
+    DistanceMatrix &distanceMatrix = dataServer.distanceMatrix;
+    distanceMatrix.compute(points, means, dataServer.threadPool, 3);    //  a tile size that does not divide n or m
+    assert(n == distanceMatrix.numOfRows());
+    assert(m == distanceMatrix.numOfMeans());
+
+    //  Check results
+    for (int i = 0; i < n; ++i) {
+        std::vector<long> pDistances(m);
+        for (int j = 0; j < m; ++j)
+            for (int dim = 0; dim < DIM; ++dim) pDistances[j] += pow(tempArrs[i][dim] - tempArrs2[j][dim], 2);
+        assert(pDistances == keysServer.decryptNums(distanceMatrix.row(points[i])));
+
+        //  the 2 closest (the first ones, on ties)
+        std::vector<int> order(m);
+        for (int j = 0; j < m; ++j) order[j] = j;
+        std::stable_sort(order.begin(), order.end(), [&pDistances](int a, int b) {
+            return pDistances[a] < pDistances[b];
+        });
+
+        std::pair<Point, EncryptedNum> closest = distanceMatrix.closest(points[i], &dataServer.threadPool);
+        assert(order[0] == keysServer.decryptNum(closest.first.cid));
+        assert(pDistances[order[0]] == keysServer.decryptNum(closest.second));
+
+        auto[first, firstDistance, second, secondDistance] = distanceMatrix.twoClosest(points[i], &dataServer.threadPool);
+        assert(order[0] == keysServer.decryptNum(first.cid));
+        assert(pDistances[order[0]] == keysServer.decryptNum(firstDistance));
+        assert(order[1] == keysServer.decryptNum(second.cid));
+        assert(pDistances[order[1]] == keysServer.decryptNum(secondDistance));
+    }
+
+    //  the same minimal distances as computing them point by point
+    const std::vector<std::tuple<Point, Point, EncryptedNum> >
+            minDistanceTuples_WithThreads =
+            dataServer.collectMinimalDistancesAndClosestPoints_WithThreads(points, means);
+    for (const auto &tuple: minDistanceTuples_WithThreads) {
+        const Point &point = std::get<0>(tuple);
+        assert(keysServer.decryptNum(point.findMinDistFromMeans(means, keysServer).second)
+               == keysServer.decryptNum(std::get<2>(tuple)));
+    }
+
+    cout << " ------ testDistanceMatrix finished ------ " << endl << endl;
+}
+
+void TestDataServer::testCapacityMonitor() {
+    cout << " ------ testCapacityMonitor ------ " << endl;
+    const KeysServer keysServer;
+    ThreadPool threadPool(NUMBER_OF_THREADS);
+    const helib::PubKey &public_key = keysServer.getPublicKey();
+
+    //  a threshold no fresh ciphertext reaches, so everything the stage touched must be recrypted
+    CapacityMonitor capacityMonitor(public_key, 1e6, 3);
+    int n = NUMBER_OF_POINTS;
+    std::vector<Ctxt> bits;
+    std::vector<long> pBits(n);
+    for (int i = 0; i < n; ++i) {
+        pBits[i] = randomLongInRange(mt) % 2;
+        bits.push_back(keysServer.encryptCtxt(pBits[i]));
+        //  a "stage" - a few squarings (b * b = b) consume capacity without changing the bit
+        for (int j = 0; j < 3; ++j) bits.back().multiplyBy(Ctxt(bits.back()));
+    }
+    bits.emplace_back(public_key);  //  an empty (zero) ciphertext is ignored
+
+    std::vector<Ctxt *> ctxts;
+    for (Ctxt &bit: bits) ctxts.push_back(&bit);
+    long recrypted = capacityMonitor.checkpoint("squarings", ctxts, threadPool);
+    capacityMonitor.printReport();
+
+    const CapacityMonitor::StageReport &report = capacityMonitor.getReports().back();
+    assert(0 < report.consumed());
+    assert(report.capacityOut <= report.capacityIn);
+    if (public_key.isBootstrappable()) assert(n == recrypted);
+    else assert(0 == recrypted);
+    for (int i = 0; i < n; ++i) assert(pBits[i] == keysServer.decryptCtxt(bits[i]));
+
+    //  w/o bootstrapping - the keys server refreshes them instead
+    if (!public_key.isBootstrappable()) {
+        KeysServerChannel channel(keysServer);
+        capacityMonitor.setRefresher([&channel](const std::vector<Ctxt> &batch) { return channel.refresh(batch); });
+        assert(n == capacityMonitor.checkpoint("refreshed", ctxts, threadPool));
+        assert(capacityMonitor.getReports().back().capacityAfter > capacityMonitor.getReports().back().capacityOut);
+        for (int i = 0; i < n; ++i) assert(pBits[i] == keysServer.decryptCtxt(bits[i]));
+    }
+
+    //  planned thresholds - the output of a stage must survive the next one (the last one's, the first one)
+    capacityMonitor.setStageDepths({{"first", 2}, {"second", 5}});
+    assert(5 * KeysServer::BITS_PER_LEVEL == capacityMonitor.thresholdOf("first"));
+    assert(2 * KeysServer::BITS_PER_LEVEL == capacityMonitor.thresholdOf("second"));
+    assert(1e6 == capacityMonitor.thresholdOf("squarings"));
+
+    cout << " ------ testCapacityMonitor finished ------ " << endl << endl;
+}
+
 void TestDataServer::testCalculateThreshold() {
     cout << " ------ testCalculateThreshold ------ " << endl;
     const KeysServer keysServer;
@@ -791,6 +1108,7 @@ void TestDataServer::testChoosePointsByDistance() {
         points2.emplace_back(Point(keysServer.getPublicKey(), tempArrs2[i]));
     }
     std::vector<Point> dummyMeans(points2.begin(), points2.begin() + DIM);
+    for (int i = 0; i < dummyMeans.size(); ++i) dummyMeans[i].setCid(i); // cid is the index of the mean
 
     //  Calculating Algorithm
     const std::vector<std::tuple<Point, Point, EncryptedNum> >
@@ -879,6 +1197,7 @@ void TestDataServer::testChoosePointsByDistance_WithThreads() {
         points2.emplace_back(Point(keysServer.getPublicKey(), tempArrs2[i]));
     }
     std::vector<Point> dummyMeans(points2.begin(), points2.begin() + DIM);
+    for (int i = 0; i < dummyMeans.size(); ++i) dummyMeans[i].setCid(i); // cid is the index of the mean
 
     //  Calculating Algorithm
     const std::vector<std::tuple<Point, Point, EncryptedNum> >
@@ -1052,6 +1371,7 @@ void TestDataServer::testChoosePointsByDistance_WithThreads_withYonis() {
         points2.emplace_back(Point(keysServer.getPublicKey(), tempArrs2[i]));
     }
     std::vector<Point> dummyMeans(points2.begin(), points2.begin() + DIM);
+    for (int i = 0; i < dummyMeans.size(); ++i) dummyMeans[i].setCid(i); // cid is the index of the mean
 
     //  Calculating Algorithm
     const std::vector<std::tuple<Point, Point, EncryptedNum> >
@@ -1140,12 +1460,12 @@ void TestDataServer::testChoosePointsByDistance_WithThreads_withYonis() {
         // add all non-zero points
         for (auto const &pair: points) {
             const Point &currPoint(pair.first);
-            std::vector<long> tempPoint = decryptPoint(currPoint, keysServer);
-            std::vector<double> doublePoint(DIM);
+            std::vector<double> doublePoint;
+            doublePoint.reserve(DIM);
             long checkNull = 0;
             for (const long &coordinate:decryptPoint(currPoint, keysServer)) {
                 checkNull += coordinate;
-                doublePoint.emplace_back(coordinate / CONVERSION_FACTOR);
+                doublePoint.emplace_back(double(coordinate) / CONVERSION_FACTOR);
             }
             if (checkNull) pointsGroup.emplace_back(doublePoint);
             forClean.emplace_back(currPoint);
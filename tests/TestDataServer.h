@@ -16,16 +16,24 @@ public:
 
     static void testRetrievePoints_Threads();
 
+    static void testRetrievePoints_FromFiles();
+
+    static void testStreamingChunks();
+
     static void testPickRandomPoints();
 
     static void testCreateCmpDict();
 
     static void testCreateCmpDict_Threads();
 
+    static void testCreateCmpDict_Incremental();
+
     static void testSplitIntoEpsNet();
 
     static void testSplitIntoEpsNet_WithThreads();
 
+    static void testSplitIntoEpsNet_SortedReps();
+
     static void testCalculateCellMeans();
 
     static void testCalculateCellMeans_WithThreads();
@@ -36,6 +44,10 @@ public:
 
     static void testGetMinimalDistances_WithThreads();
 
+    static void testDistanceMatrix();
+
+    static void testCapacityMonitor();
+
     static void testChoosePointsByDistance();
 
     static void testChoosePointsByDistance_WithThreads();
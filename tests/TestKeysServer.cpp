@@ -3,6 +3,7 @@
 
 #include "utils/Logger.h"
 #include "src/Client.h"
+#include "src/KeysServerChannel.h"
 
 void TestKeysServer::testConstructor() {
     cout << " ------ testConstructor ------ " << endl;
@@ -12,6 +13,62 @@ void TestKeysServer::testConstructor() {
     cout << " ------ testConstructor finished ------ " << endl << endl;
 }
 
+void TestKeysServer::testKeyStore() {
+    cout << " ------ testKeyStore ------ " << endl;
+    if (KEYS_DIR.empty()) {
+        //  no key store - every KeysServer generates its own keys
+        cout << " ------ testKeyStore skipped (no keys_dir in the config) ------ " << endl << endl;
+        return;
+    }
+
+    auto t0_generate = CLOCK::now();
+    KeysServer keysServer;  //  generates the keys (or loads them, if an earlier run stored them)
+    printDuration(t0_generate, "first KeysServer");
+
+    auto t0_load = CLOCK::now();
+    KeysServer loadedKeysServer;    //  loads the stored keys
+    printDuration(t0_load, "second KeysServer");
+    assert(loadedKeysServer.areKeysLoaded());
+
+    //  the same keys - a number encrypted by one is decrypted by the other
+    const long l = randomLongInRange(mt);
+    EncryptedNum cl = keysServer.encryptNum(l);
+    assert(l == loadedKeysServer.decryptNum(cl));
+
+    cout << " ------ testKeyStore finished ------ " << endl << endl;
+}
+
+void TestKeysServer::testPlanParams() {
+    cout << " ------ testPlanParams ------ " << endl;
+
+    const KeysServer::FheParams params = KeysServer::planParams();
+    KeysServer::printParams(params);
+    for (auto const &[stage, depth]: params.stageDepths) assert(0 < depth && depth <= params.depth);
+    assert(params.depth * 30 < params.L);
+    assert(1 <= params.slots);
+
+    //  more slots, or a deeper circuit, can only cost more
+    const KeysServer::FheParams packed = KeysServer::planParams(NUMBER_OF_POINTS, DIM, BIT_SIZE, EPSILON, true,
+                                                                params.slots + 1);
+    assert(params.prm < packed.prm && params.slots < packed.slots && params.multCost < packed.multCost);
+    const KeysServer::FheParams wider = KeysServer::planParams(NUMBER_OF_POINTS, DIM, 2 * BIT_SIZE);
+    assert(params.depth <= wider.depth && params.L <= wider.L);
+    //  w/o bootstrapping L has to cover all the iterations
+    const KeysServer::FheParams noBootstrap = KeysServer::planParams(NUMBER_OF_POINTS, DIM, BIT_SIZE, EPSILON, false);
+    assert(params.depth < noBootstrap.depth);
+
+    bool thrown = false;
+    try { KeysServer::planParams(NUMBER_OF_POINTS, DIM, BIT_SIZE, EPSILON, true, 1L << 20); }
+    catch (const std::invalid_argument &e) { thrown = true; }
+    assert(thrown);
+
+    //  the c'tor uses the plan
+    KeysServer keysServer;
+    assert(params.slots == keysServer.getContextDBG().getEA().size());
+
+    cout << " ------ testPlanParams finished ------ " << endl << endl;
+}
+
 void TestKeysServer::testEncryptCtxt() {
     cout << " ------ testConstructor ------ " << endl;
     
@@ -74,6 +131,127 @@ void TestKeysServer::testDecryptNum() {
     cout << " ------ testDecryptNum finished ------ " << endl << endl;
 }
 
+void TestKeysServer::testDecryptNums() {
+    cout << " ------ testDecryptNums ------ " << endl;
+
+    KeysServer keysServer;
+
+    std::vector<long> nums(NUMBER_OF_POINTS);
+    std::vector<EncryptedNum> cNums;
+    cNums.reserve(nums.size());
+    for (long &num: nums) {
+        num = randomLongInRange(mt);
+        cNums.push_back(keysServer.encryptNum(num));
+    }
+
+    const std::vector<long> pNums = keysServer.decryptNums(cNums);
+
+    assert(nums == pNums);
+    for (const EncryptedNum &cNum: cNums) assert(keysServer.decryptNum(cNum) == keysServer.decryptNums({cNum})[0]);
+
+    cout << " ------ testDecryptNums finished ------ " << endl << endl;
+}
+
+void TestKeysServer::testDecryptPoints() {
+    cout << " ------ testDecryptPoints ------ " << endl;
+
+    KeysServer keysServer;
+
+    std::vector<Point> points;
+    std::vector<DecryptedPoint> pPoints(NUMBER_OF_POINTS, DecryptedPoint(DIM));
+    points.reserve(pPoints.size());
+    for (DecryptedPoint &pPoint: pPoints) {
+        for (long &coor: pPoint) coor = randomLongInRange(mt);
+        points.emplace_back(keysServer.getPublicKey(), pPoint.data());
+    }
+
+    assert(pPoints == keysServer.decryptPoints(points));
+
+    cout << " ------ testDecryptPoints finished ------ " << endl << endl;
+}
+
+//  the divisions of testGetQuotientPoints and testKeysServerChannel:
+//  a "slice" per point - the point is the sum, and i of its bits are on
+struct QuotientsFixture {
+    std::vector<Point> sums;
+    std::vector<std::vector<Ctxt> > sizeBitVectors;
+    std::vector<const std::vector<Ctxt> *> sizes;   //  into sizeBitVectors
+    std::vector<DecryptedPoint> pQuotients;         //  the expected quotients
+};
+
+static void makeQuotientsFixture(const KeysServer &keysServer, short repsNum, QuotientsFixture &fixture) {
+    fixture.sizeBitVectors.assign(NUMBER_OF_POINTS, {});
+    fixture.pQuotients.assign(NUMBER_OF_POINTS, DecryptedPoint(DIM));
+    for (int i = 0; i < NUMBER_OF_POINTS; ++i) {
+        DecryptedPoint pSum(DIM);
+        for (long &coor: pSum) coor = randomLongInRange(mt);
+        fixture.sums.emplace_back(keysServer.getPublicKey(), pSum.data());
+        for (int bit = 0; bit < NUMBER_OF_POINTS; ++bit)
+            fixture.sizeBitVectors[i].push_back(keysServer.encryptCtxt(bit < i));
+        for (short dim = 0; dim < DIM; ++dim) fixture.pQuotients[i][dim] = pSum[dim] / (repsNum + i);
+    }
+    for (const std::vector<Ctxt> &sizeBitVector: fixture.sizeBitVectors) fixture.sizes.push_back(&sizeBitVector);
+}
+
+void TestKeysServer::testGetQuotientPoints() {
+    cout << " ------ testGetQuotientPoints ------ " << endl;
+
+    KeysServer keysServer;
+    const short repsNum = DIM;
+    QuotientsFixture fixture;
+    makeQuotientsFixture(keysServer, repsNum, fixture);
+
+    const std::vector<Point> quotients = keysServer.getQuotientPoints(fixture.sums, fixture.sizes, repsNum);
+    assert(fixture.pQuotients == keysServer.decryptPoints(quotients));
+    //  the same as one by one
+    assert(decryptPoint(keysServer.getQuotientPoint(fixture.sums.back(), fixture.sizeBitVectors.back(), repsNum),
+                        keysServer)
+           == fixture.pQuotients.back());
+
+    cout << " ------ testGetQuotientPoints finished ------ " << endl << endl;
+}
+
+void TestKeysServer::testKeysServerChannel() {
+    cout << " ------ testKeysServerChannel ------ " << endl;
+
+    KeysServer keysServer;
+    const short repsNum = DIM;
+    QuotientsFixture fixture;
+    makeQuotientsFixture(keysServer, repsNum, fixture);
+    const std::vector<Point> &sums = fixture.sums;
+    const std::vector<const std::vector<Ctxt> *> &sizes = fixture.sizes;
+
+    const long l = randomLongInRange(mt), divisor = 1 + randomLongInRange(mt);
+    const EncryptedNum cl = keysServer.encryptNum(l);
+    const std::vector<Ctxt> ctxts{keysServer.encryptCtxt(true), keysServer.encryptCtxt(false)};
+
+    ThreadPool threadPool(NUMBER_OF_THREADS);
+    for (KeysServerChannel::Transport transport: {KeysServerChannel::Transport::IN_PROCESS,
+                                                  KeysServerChannel::Transport::SOCKET}) {
+        KeysServerChannel channel(keysServer, transport);
+
+        //  all the requests are sent before any of the responses is waited for
+        std::future<std::vector<Point> > first = channel.getQuotientPoints(
+                std::vector<Point>(sums.begin(), sums.begin() + 1),
+                std::vector<const std::vector<Ctxt> *>(sizes.begin(), sizes.begin() + 1),
+                repsNum);
+        std::future<std::vector<Point> > all = channel.getQuotientPoints(sums, sizes, repsNum);
+        std::future<EncryptedNum> quotient = channel.getQuotient(cl, divisor);
+        std::future<std::vector<Ctxt> > refreshed = channel.refresh(ctxts);
+
+        //  the futures become ready on their own (not deferred) - so they can be polled, as the stages wait for them
+        assert(std::future_status::deferred != first.wait_for(std::chrono::seconds(0)));
+        assert(std::vector<DecryptedPoint>{fixture.pQuotients.front()} == keysServer.decryptPoints(first.get()));
+        assert(fixture.pQuotients == keysServer.decryptPoints(threadPool.wait(all)));
+        assert(l / divisor == keysServer.decryptNum(threadPool.wait(quotient)));
+        const std::vector<Ctxt> fresh = refreshed.get();
+        assert(keysServer.decryptCtxt(fresh[0]) && !keysServer.decryptCtxt(fresh[1]));
+        for (int i = 0; i < ctxts.size(); ++i) assert(fresh[i].capacity() >= ctxts[i].capacity());
+    }
+
+    cout << " ------ testKeysServerChannel finished ------ " << endl << endl;
+}
+
 void TestKeysServer::testScratchPoint() {
     cout << " ------ testEncryptScratchPoint ------ " << endl;
     
@@ -11,6 +11,10 @@ class TestKeysServer {
 public:
     static void testConstructor();
 
+    static void testKeyStore();
+
+    static void testPlanParams();
+
     static void testEncryptCtxt();
 
     static void testDecryptCtxt();
@@ -19,6 +23,14 @@ public:
 
     static void testDecryptNum();
 
+    static void testDecryptNums();
+
+    static void testDecryptPoints();
+
+    static void testGetQuotientPoints();
+
+    static void testKeysServerChannel();
+
     static void testScratchPoint();
 
     static void testTinyRandomPoint();
@@ -2,6 +2,13 @@
 
 #include "TestPoint.h"
 
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <sys/resource.h>
+#include <unistd.h>
+
 #include "src/Point.h"
 
 void TestPoint::testConstructor() {
@@ -227,6 +234,53 @@ void TestPoint::testCalculateDistanceFromPoint() {
     cout << " ------ testCalculateDistanceFromPoint finished ------ " << endl << endl;
 }
 
+void TestPoint::testDistanceKernels() {
+    cout << " ------ testDistanceKernels ------ " << endl;
+    KeysServer keysServer;
+    int n = NUMBER_OF_POINTS;
+    std::vector<Point> points;
+
+    long arrs[n][DIM];
+    for (int i = 0; i < n; ++i) {
+        for (int dim = 0; dim < DIM; ++dim) arrs[i][dim] = randomLongInRange(mt);
+        points.emplace_back(Point(keysServer.getPublicKey(), arrs[i]));
+    }
+    //  the edges of the range too - the largest difference, in both directions, and no difference at all
+    long low[DIM], high[DIM];
+    for (int dim = 0; dim < DIM; ++dim) low[dim] = 0, high[dim] = NUMBERS_RANGE;
+    Point lowPoint(keysServer.getPublicKey(), low), highPoint(keysServer.getPublicKey(), high);
+
+    for (DistanceKernel kernel: {DistanceKernel::CMP, DistanceKernel::SQUARED_DIFF}) {
+        assert(DIM * NUMBERS_RANGE * NUMBERS_RANGE == keysServer.decryptNum(
+                Point::squaredDistance(lowPoint.cCoordinates, highPoint.cCoordinates, keysServer.getPublicKey(), kernel)));
+        assert(DIM * NUMBERS_RANGE * NUMBERS_RANGE == keysServer.decryptNum(
+                Point::squaredDistance(highPoint.cCoordinates, lowPoint.cCoordinates, keysServer.getPublicKey(), kernel)));
+        assert(0 == keysServer.decryptNum(
+                Point::squaredDistance(highPoint.cCoordinates, highPoint.cCoordinates, keysServer.getPublicKey(), kernel)));
+
+        auto t0_kernel = CLOCK::now();
+        std::vector<EncryptedNum> distances;
+        distances.reserve(n - 1);
+        for (int i = 0; i < n - 1; ++i)
+            distances.push_back(Point::squaredDistance(
+                    points[i].cCoordinates, points[i + 1].cCoordinates, keysServer.getPublicKey(), kernel));
+        printDuration(t0_kernel, kernel == DistanceKernel::CMP ? "squaredDistance x" + std::to_string(n - 1) + " (cmp)"
+                                                               : "squaredDistance x" + std::to_string(n - 1) + " (squared diff)");
+
+        std::vector<long> dDistances = keysServer.decryptNums(distances);
+        for (int i = 0; i < n - 1; ++i) {
+            long pDistSquared = 0;
+            for (int dim = 0; dim < DIM; ++dim)
+                pDistSquared += std::pow((arrs[i][dim] - arrs[i + 1][dim]), 2);
+            assert(pDistSquared == dDistances[i]);
+        }
+        //  the capacity left is what later stages (comparisons of distances) can still spend
+        printNameVal(distances.front().front().capacity());
+    }
+
+    cout << " ------ testDistanceKernels finished ------ " << endl << endl;
+}
+
 void TestPoint::testFindMinimalDistancesFromMeans() {
     cout << " ------ testFindMinimalDistancesFromMeans ------ " << endl;
     KeysServer keysServer;
@@ -241,34 +295,52 @@ void TestPoint::testFindMinimalDistancesFromMeans() {
     for (int i = 0; i < n; ++i) {
         for (int dim = 0; dim < DIM; ++dim) arrs[i][dim] = randomLongInRange(mt);
         points.push_back(Point(keysServer.getPublicKey(), arrs[i]));
+        points.back().setCid(i % NUMBER_OF_MEANS);    //  the cid of a mean is its index (there are at most NUMBER_OF_MEANS)
     }
 
     std::pair<Point, EncryptedNum>
             minimalDistance = point.findMinDistFromMeans(points, keysServer);
+    ThreadPool threadPool(NUMBER_OF_THREADS);
+    std::pair<Point, EncryptedNum>
+            minimalDistance_WithThreads = point.findMinDistFromMeans(points, keysServer, &threadPool);
+    std::vector<CBit> oneHot, oneHot_WithThreads;
+    point.findMinDistFromMeans(points, keysServer, nullptr, &oneHot);
+    point.findMinDistFromMeans(points, keysServer, &threadPool, &oneHot_WithThreads);
 
     Point &minDistPoint = points[0];
     long pMinDist = DIM * pow(NUMBERS_RANGE, 2);
-    long minId = -1;
+    long minId = -1, minIndex = -1;
     EncryptedNum minCid;//(BIT_SIZE, Ctxt(publicKey));
 
     for (int i = 0; i < n; ++i) {
         long pDist = 0;
         for (int dim = 0; dim < DIM; ++dim) pDist += std::pow(arrs[i][dim] - arr[dim], 2);
 
-        if (pMinDist >= pDist) {
+        if (pMinDist > pDist) {    //  on a tie - the first of the closest points
             minDistPoint = points[i];
             pMinDist = pDist;
             minId = points[i].id;
+            minIndex = i;
             minCid = points[i].cid;
         }
     }
 
+    //  the one-hot assignment is 1 only at the (first) closest point
+    assert(n == oneHot.size() && n == oneHot_WithThreads.size());
+    for (int i = 0; i < n; ++i) {
+        assert((i == minIndex) == keysServer.decryptCtxt(oneHot[i]));
+        assert((i == minIndex) == keysServer.decryptCtxt(oneHot_WithThreads[i]));
+    }
+
     assert(pMinDist == keysServer.decryptNum(minimalDistance.second));
     //    printNameVal(minId);
     //    printNameVal(keysServer.decryptNum(minCid));
     //    printNameVal(keysServer.decryptNum(minimalDistance.first.cid));
     //    assert(minId == keysServer.decryptNum(minimalDistance.first.cid));
     assert(keysServer.decryptNum(minCid) == keysServer.decryptNum(minimalDistance.first.cid));
+    assert(pMinDist == keysServer.decryptNum(minimalDistance_WithThreads.second));
+    assert(keysServer.decryptNum(minCid) == keysServer.decryptNum(minimalDistance_WithThreads.first.cid));
+    assert(decryptPoint(minDistPoint, keysServer) == decryptPoint(minimalDistance.first, keysServer));
     //    assert(minDistPoint == minimalDistance.first);
     //    assert(minDistPoint.id == minimalDistance.first.id);
     //    assert(minDistPoint.cid == minimalDistance.first.cid);
@@ -300,3 +372,168 @@ void TestPoint::testFindMinimalDistancesFromMeans() {
 
 
 }
+
+void TestPoint::testSortByDim() {
+    cout << " ------ testSortByDim ------ " << endl;
+    KeysServer keysServer;
+    ThreadPool threadPool(NUMBER_OF_THREADS);
+
+    //  every size up to a power of 2 and over it (so the padded network is covered too)
+    for (int n = 1; n <= 9; ++n)
+        for (short dim = 0; dim < DIM; ++dim) {
+            std::vector<Point> points;
+            std::vector<DecryptedPoint> pPoints;
+            for (int i = 0; i < n; ++i) {
+                long arr[DIM];
+                for (long &coor: arr) coor = randomLongInRange(mt);
+                points.emplace_back(keysServer.getPublicKey(), arr);
+                pPoints.emplace_back(arr, arr + DIM);
+            }
+            std::stable_sort(pPoints.begin(), pPoints.end(),
+                             [dim](const DecryptedPoint &a, const DecryptedPoint &b) { return a[dim] < b[dim]; });
+
+            const std::vector<Point> sorted = Point::sortByDim(points, dim, (n % 2) ? &threadPool : nullptr);
+            assert(n == sorted.size());
+            const std::vector<DecryptedPoint> pSorted = keysServer.decryptPoints(sorted);
+            for (int i = 0; i < n; ++i) assert(pPoints[i][dim] == pSorted[i][dim]);
+            //  the same points (ties may come in any order)
+            std::vector<DecryptedPoint> expected(pPoints), actual(pSorted);
+            std::sort(expected.begin(), expected.end());
+            std::sort(actual.begin(), actual.end());
+            assert(expected == actual);
+            //  new ids
+            for (const Point &point: sorted)
+                for (const Point &original: points) assert(point.id != original.id);
+        }
+
+    cout << " ------ testSortByDim finished ------ " << endl << endl;
+}
+
+void TestPoint::testCopyWithCtxtPool() {
+    cout << " ------ testCopyWithCtxtPool ------ " << endl;
+    KeysServer keysServer;
+    CtxtPool pool(DIM * BIT_SIZE + CID_BIT_SIZE);   //  room for exactly one point
+
+    long arr[DIM];
+    for (long &a :arr) a = randomLongInRange(mt);
+    Point point(keysServer.getPublicKey(), arr);
+
+    //  an empty pool - every ciphertext is allocated
+    Point first(point, pool);
+    assert(first.id == point.id);
+    assert(decryptPoint(first, keysServer) == decryptPoint(point, keysServer));
+    assert(0 == pool.reusedCount());
+
+    first.recycle(pool);
+    assert(first.isEmpty());
+    assert(DIM * BIT_SIZE + CID_BIT_SIZE == pool.size());
+
+    //  now every ciphertext is a recycled one
+    for (long &a :arr) a = randomLongInRange(mt);
+    Point other(keysServer.getPublicKey(), arr);
+    Point second(other, pool);
+    assert(0 == pool.size());
+    assert(DIM * BIT_SIZE + CID_BIT_SIZE == pool.reusedCount());
+    assert(decryptPoint(second, keysServer) == decryptPoint(other, keysServer));
+
+    //  over the capacity - the rest are released
+    second.recycle(pool);
+    Point(point).recycle(pool);
+    assert(DIM * BIT_SIZE + CID_BIT_SIZE == pool.size());
+
+    cout << " ------ testCopyWithCtxtPool finished ------ " << endl << endl;
+}
+
+//  the resident set size of the process, in KB
+static long residentKB() {
+    std::ifstream statm("/proc/self/statm");
+    long size = 0, resident = 0;
+    statm >> size >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+//  the peak resident set size of the process, in KB
+static long peakResidentKB() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static const char *const CTXT_POOL_BENCHMARK_MODE = "CTXT_POOL_BENCHMARK_MODE";
+static const std::string CTXT_POOL_BENCHMARK_RESULT = "benchmarkCtxtPool result:";
+
+int TestPoint::benchmarkCtxtPool_Mode() {
+    const bool pooled = "pooled" == std::string(std::getenv(CTXT_POOL_BENCHMARK_MODE));
+    KeysServer keysServer;
+    ThreadPool threadPool(NUMBER_OF_THREADS);
+    const int rounds = 8;
+
+    std::vector<Point> points;
+    for (int i = 0; i < NUMBER_OF_POINTS; ++i) {
+        long arr[DIM];
+        for (long &a :arr) a = randomLongInRange(mt);
+        points.emplace_back(keysServer.getPublicKey(), arr);
+    }
+    //  as in clearForNextIteration - room for one copy of all the points
+    CtxtPool pool(long(points.size()) * (DIM * BIT_SIZE + CID_BIT_SIZE));
+    const long setupKB = residentKB();
+
+    //  as in the iterations: every round the copies of the previous one are retired, and all the points are copied
+    //  again (by all the threads). either the copies are released and allocated again, or they are recycled
+    std::vector<std::vector<Point> > copies(NUMBER_OF_THREADS);
+    auto t0_run = CLOCK::now();
+    for (int round = 0; round < rounds; ++round) {
+        std::vector<std::future<void> > futures;
+        for (int thread = 0; thread < NUMBER_OF_THREADS; ++thread)
+            futures.push_back(threadPool.submit([&, thread]() {
+                if (pooled) for (Point &copy: copies[thread]) copy.recycle(pool);
+                copies[thread].clear();
+                for (long i = thread; i < points.size(); i += NUMBER_OF_THREADS)
+                    if (pooled) copies[thread].emplace_back(points[i], pool);
+                    else copies[thread].emplace_back(points[i]);
+            }));
+        threadPool.wait(futures);
+    }
+    const long duration = std::chrono::duration_cast<std::chrono::milliseconds>(CLOCK::now() - t0_run).count();
+
+    cout << CTXT_POOL_BENCHMARK_RESULT << " " << rounds << " " << points.size() << " " << duration
+         << " " << setupKB << " " << residentKB() << " " << peakResidentKB()
+         << " " << pool.reusedCount() << " " << pool.allocatedCount() << endl;
+    return 0;
+}
+
+void TestPoint::benchmarkCtxtPool() {
+    cout << " ------ benchmarkCtxtPool ------ " << endl;
+
+    //  every mode runs in a fresh process (this executable, see test.cpp) - in this one the heap was already
+    //  grown (and not given back) by the other tests, and by the mode that ran first
+    char exe[4096] = {};
+    const ssize_t exeLength = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    assert(0 < exeLength);
+
+    for (const std::string mode: {"allocated", "pooled"}) {
+        const std::string command = std::string(CTXT_POOL_BENCHMARK_MODE) + "=" + mode + " '" + exe + "'";
+        FILE *child = popen(command.c_str(), "r");
+        assert(child);
+        std::string result;
+        char line[1024];
+        while (fgets(line, sizeof(line), child))
+            if (0 == std::string(line).rfind(CTXT_POOL_BENCHMARK_RESULT, 0)) result = line;
+        const int status = pclose(child);
+        assert(0 == status && !result.empty());
+
+        std::istringstream fields(result.substr(CTXT_POOL_BENCHMARK_RESULT.size()));
+        long rounds, numOfPoints, duration, setupKB, endKB, peakKB, reused, allocated;
+        fields >> rounds >> numOfPoints >> duration >> setupKB >> endKB >> peakKB >> reused >> allocated;
+
+        cout << " ---   " << mode << ": " << rounds << " rounds of copying " << numOfPoints << " points   ---" << endl;
+        printNameVal(duration);     //  ms
+        cout << "   RSS over the setup (KB): +" << endKB - setupKB << " at the end, +" << peakKB - setupKB
+             << " at the peak" << endl;
+        if ("pooled" == mode)
+            cout << "   " << reused << " ciphertexts reused, " << allocated << " allocated" << endl;
+    }
+    cout << " --- --- --- --- ---" << endl;
+
+    cout << " ------ benchmarkCtxtPool finished ------ " << endl << endl;
+}
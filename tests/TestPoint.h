@@ -23,7 +23,18 @@ public:
 
     static void testCalculateDistanceFromPoint();
 
+    static void testDistanceKernels();
+
     static void testFindMinimalDistancesFromMeans();
+
+    static void testSortByDim();
+
+    static void testCopyWithCtxtPool();
+
+    static void benchmarkCtxtPool();
+
+    //! one mode of \fn{benchmarkCtxtPool}, in a process of its own (see test.cpp)
+    static int benchmarkCtxtPool_Mode();
 };
 
 #endif //ENCRYPTEDKMEANS_TESTPOINT_H
@@ -0,0 +1,126 @@
+
+#include "TestPointBatch.h"
+
+#include "src/PointBatch.h"
+
+static std::vector<DecryptedPoint> randomPoints(long n) {
+    std::vector<DecryptedPoint> points(n, DecryptedPoint(DIM));
+    for (DecryptedPoint &p: points)
+        for (long &coor: p) coor = randomLongInRange(mt);
+    return points;
+}
+
+void TestPointBatch::testConstructor() {
+    cout << " ------ testConstructor ------ " << endl;
+    KeysServer keysServer;
+    const long slots = PointBatch::slotsCount(keysServer.getPublicKey());
+    printNameVal(slots);
+
+    std::vector<DecryptedPoint> points = randomPoints(slots - 1);
+    PointBatch batch(keysServer.getPublicKey(), points);
+    assert(batch.size() == points.size());
+    assert(points == decryptPointBatch(batch, keysServer));
+
+    //  more points than slots are split into several batches
+    std::vector<PointBatch> batches = PointBatch::pack(keysServer.getPublicKey(), randomPoints(slots + 1));
+    assert(2 == batches.size());
+    assert(slots == batches[0].size() && 1 == batches[1].size());
+
+    cout << " ------ testConstructor finished ------ " << endl << endl;
+}
+
+void TestPointBatch::testCompare() {
+    cout << " ------ testCompare ------ " << endl;
+    KeysServer keysServer;
+    std::vector<DecryptedPoint> points = randomPoints(PointBatch::slotsCount(keysServer.getPublicKey()));
+    PointBatch batch(keysServer.getPublicKey(), points);
+
+    long arr[DIM];
+    for (long &a :arr) a = randomLongInRange(mt);
+    Point point(keysServer.getPublicKey(), arr);
+
+    for (short dim = 0; dim < DIM; ++dim) {
+        std::vector<CBit> res = batch.isBiggerThan(point, dim);
+        std::vector<long> batchIsBigger = keysServer.decryptNumSlots({res[0]});
+        std::vector<long> pointIsBigger = keysServer.decryptNumSlots({res[1]});
+        for (long i = 0; i < batch.size(); ++i) {
+            assert(batchIsBigger[i] == (points[i][dim] > arr[dim]));
+            assert(pointIsBigger[i] == (arr[dim] > points[i][dim]));
+        }
+    }
+
+    //  a point packed in the batch is "bigger" than itself both ways, like in Point::isBiggerThan
+    Point extracted = batch.extract(0);
+    std::vector<CBit> res = batch.isBiggerThan(extracted, 0);
+    assert(1 == keysServer.decryptNumSlots({res[0]})[0]);
+    assert(1 == keysServer.decryptNumSlots({res[1]})[0]);
+
+    cout << " ------ testCompare finished ------ " << endl << endl;
+}
+
+void TestPointBatch::testCalculateDistanceFromPoint() {
+    cout << " ------ testCalculateDistanceFromPoint ------ " << endl;
+    KeysServer keysServer;
+    std::vector<DecryptedPoint> points = randomPoints(PointBatch::slotsCount(keysServer.getPublicKey()));
+    PointBatch batch(keysServer.getPublicKey(), points);
+
+    long arr[DIM];
+    for (long &a :arr) a = randomLongInRange(mt);
+    Point point(keysServer.getPublicKey(), arr);
+
+    auto t0 = CLOCK::now();
+    std::vector<long> distances = keysServer.decryptNumSlots(batch.distanceFrom(point));
+    cout << printDuration(t0, "PointBatch::distanceFrom (" + std::to_string(batch.size()) + " points)") << endl;
+
+    for (long i = 0; i < batch.size(); ++i) {
+        long pDistance = 0;
+        for (short dim = 0; dim < DIM; ++dim)
+            pDistance += (points[i][dim] - arr[dim]) * (points[i][dim] - arr[dim]);
+        assert(pDistance == distances[i]);
+    }
+    cout << " ------ testCalculateDistanceFromPoint finished ------ " << endl << endl;
+}
+
+void TestPointBatch::testFindMinimalDistancesFromMeans() {
+    cout << " ------ testFindMinimalDistancesFromMeans ------ " << endl;
+    KeysServer keysServer;
+    std::vector<DecryptedPoint> points = randomPoints(PointBatch::slotsCount(keysServer.getPublicKey()));
+    PointBatch batch(keysServer.getPublicKey(), points);
+
+    std::vector<DecryptedPoint> pMeans = randomPoints(3);
+    std::vector<Point> means;
+    for (const DecryptedPoint &m: pMeans) means.emplace_back(keysServer.getPublicKey(), m.data());
+
+    auto [closest, minDistance] = batch.findMinDistFromMeans(means);
+    std::vector<DecryptedPoint> pClosest = decryptPointBatch(closest, keysServer);
+    std::vector<long> pMinDistance = keysServer.decryptNumSlots(minDistance);
+
+    for (long i = 0; i < batch.size(); ++i) {
+        long pMin = -1;
+        for (const DecryptedPoint &m: pMeans) {
+            long d = 0;
+            for (short dim = 0; dim < DIM; ++dim) d += (points[i][dim] - m[dim]) * (points[i][dim] - m[dim]);
+            if (-1 == pMin || d < pMin) pMin = d;
+        }
+        assert(pMin == pMinDistance[i]);
+        long d = 0;
+        for (short dim = 0; dim < DIM; ++dim)
+            d += (points[i][dim] - pClosest[i][dim]) * (points[i][dim] - pClosest[i][dim]);
+        assert(pMin == d);
+    }
+    cout << " ------ testFindMinimalDistancesFromMeans finished ------ " << endl << endl;
+}
+
+void TestPointBatch::testExtract() {
+    cout << " ------ testExtract ------ " << endl;
+    KeysServer keysServer;
+    std::vector<DecryptedPoint> points = randomPoints(PointBatch::slotsCount(keysServer.getPublicKey()));
+    PointBatch batch(keysServer.getPublicKey(), points);
+
+    for (long i = 0; i < batch.size(); i += 7) {
+        Point point = batch.extract(i);
+        assert(point.id == batch.ids[i]);
+        assert(points[i] == decryptPoint(point, keysServer));
+    }
+    cout << " ------ testExtract finished ------ " << endl << endl;
+}
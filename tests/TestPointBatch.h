@@ -0,0 +1,18 @@
+
+#ifndef ENCRYPTEDKMEANS_TESTPOINTBATCH_H
+#define ENCRYPTEDKMEANS_TESTPOINTBATCH_H
+
+class TestPointBatch {
+public:
+    static void testConstructor();
+
+    static void testCompare();
+
+    static void testCalculateDistanceFromPoint();
+
+    static void testFindMinimalDistancesFromMeans();
+
+    static void testExtract();
+};
+
+#endif //ENCRYPTEDKMEANS_TESTPOINTBATCH_H
@@ -4,20 +4,31 @@
 
 #include "TestKeysServer.h"
 #include "TestPoint.h"
+#include "TestPointBatch.h"
 #include "TestClient.h"
 #include "TestAux.h"
 #include "TestDataServer.h"
 
+#include <cstdlib>
+
 #include "utils/aux.h"
 
 int main() {
+    //  a mode of TestPoint::benchmarkCtxtPool, which runs this executable again for every mode
+    if (std::getenv("CTXT_POOL_BENCHMARK_MODE")) return TestPoint::benchmarkCtxtPool_Mode();
 
     cout << " ============ Test KeysServer ============ " << endl;
 //    TestKeysServer::testConstructor();
+//    TestKeysServer::testKeyStore();
+//    TestKeysServer::testPlanParams();
 //    TestKeysServer::testEncryptCtxt();
 //    TestKeysServer::testDecryptCtxt();
 //    TestKeysServer::testEncryptNum();
 //    TestKeysServer::testDecryptNum();
+//    TestKeysServer::testDecryptNums();
+//    TestKeysServer::testDecryptPoints();
+//    TestKeysServer::testGetQuotientPoints();
+//    TestKeysServer::testKeysServerChannel();
 //    TestKeysServer::testScratchPoint();
 //    TestKeysServer::testTinyRandomPoint();
     cout << " ============ Test KeysServer Finished ============ " << endl << endl;
@@ -33,13 +44,26 @@ int main() {
 //    TestPoint::testMultiplicationByBit();
 //    TestPoint::testCompare();
 //    TestPoint::testCalculateDistanceFromPoint();
+//    TestPoint::testDistanceKernels();
 //    TestPoint::testFindMinimalDistancesFromMeans();
+//    TestPoint::testSortByDim();
+//    TestPoint::testCopyWithCtxtPool();
+//    TestPoint::benchmarkCtxtPool();
     cout << " ============ Test Point Finished ============ " << endl << endl;
 
+    cout << " ============ Test PointBatch ============ " << endl;
+//    TestPointBatch::testConstructor();
+//    TestPointBatch::testCompare();
+//    TestPointBatch::testCalculateDistanceFromPoint();
+//    TestPointBatch::testFindMinimalDistancesFromMeans();
+//    TestPointBatch::testExtract();
+    cout << " ============ Test PointBatch Finished ============ " << endl << endl;
+
     cout << " ============ Test Client ============ " << endl;
 //    TestClient::testConstructor();
 //    TestClient::testEncryptCoordinates();
 //    TestClient::testDecryptCoordinates();
+//    TestClient::testEncryptPoints();
 //    TestClient::testEncryptScratchPoint();
 //    TestClient::testCompare();
     cout << " ============ Test Client Finished ============ " << endl << endl;
@@ -53,7 +77,9 @@ int main() {
 //    TestAux::testComparison_diffCtxtRepresentation();
 //    TestAux::testComparison_diffCtxtRepresentation_BGVPackedArithmetics();
 //    TestAux::testMultithreading();
+//    TestAux::testThreadPool();
     TestAux::testPythonRun();
+//    TestAux::testRunCoreset();
     //    TestAux::testIsMatchImplementation();
 //    TestAux::testPrefixAndSuffix();
 //    TestAux::testIsEqualImplementation();
@@ -65,15 +91,21 @@ int main() {
 //    TestDataServer::testComparePoints();
 //    TestDataServer::testRetrievePoints();
 //    TestDataServer::testRetrievePoints_Threads();
+//    TestDataServer::testRetrievePoints_FromFiles();
+//    TestDataServer::testStreamingChunks();
 //    TestDataServer::testPickRandomPoints();
 //    TestDataServer::testCreateCmpDict();
 //    TestDataServer::testCreateCmpDict_Threads();
+//    TestDataServer::testCreateCmpDict_Incremental();
 //    TestDataServer::testSplitIntoEpsNet();
 //    TestDataServer::testSplitIntoEpsNet_WithThreads();
+//    TestDataServer::testSplitIntoEpsNet_SortedReps();
 //    TestDataServer::testCalculateCellMeans();
 //    TestDataServer::testCalculateCellMeans_WithThreads();
 //    TestDataServer::testGetMinimalDistances();
 //    TestDataServer::testGetMinimalDistances_WithThreads();
+//    TestDataServer::testDistanceMatrix();
+//    TestDataServer::testCapacityMonitor();
 //    TestDataServer::testCalculateThreshold();
 //    TestDataServer::testChoosePointsByDistance();
 //    TestDataServer::testChoosePointsByDistance_WithThreads();
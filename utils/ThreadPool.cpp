@@ -0,0 +1,94 @@
+
+#include "ThreadPool.h"
+
+//  which pool (if any) the current thread is a worker of, and its index in that pool
+static thread_local const ThreadPool *currentPool = nullptr;
+static thread_local unsigned long currentIndex = 0;
+
+ThreadPool::ThreadPool(unsigned long numOfThreads) :
+        pendingTasks(0),
+        nextQueue(0),
+        done(false) {
+    if (0 == numOfThreads) numOfThreads = 1;
+    queues.reserve(numOfThreads);
+    for (unsigned long i = 0; i < numOfThreads; ++i) queues.emplace_back(new WorkQueue);
+    workers.reserve(numOfThreads);
+    for (unsigned long i = 0; i < numOfThreads; ++i)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lockGuard(sleepLock);
+        done = true;
+    }
+    wakeUp.notify_all();
+    for (auto &t: workers) t.join();
+}
+
+void ThreadPool::push(Task task) {
+    if (this == currentPool) {
+        //  a sub-task - keep it local (LIFO), the other workers will steal it if they are idle
+        WorkQueue &queue = *queues[currentIndex];
+        std::lock_guard<std::mutex> lockGuard(queue.lock);
+        queue.tasks.push_front(std::move(task));
+    } else {
+        WorkQueue &queue = *queues[nextQueue++ % queues.size()];
+        std::lock_guard<std::mutex> lockGuard(queue.lock);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lockGuard(sleepLock);
+        ++pendingTasks;
+    }
+    wakeUp.notify_one();
+}
+
+bool ThreadPool::popTask(Task &task) {
+    if (0 == pendingTasks) return false;
+    const bool isWorker = (this == currentPool);
+    const unsigned long first = isWorker ? currentIndex : 0;
+
+    //  own queue - from the front
+    if (isWorker) {
+        WorkQueue &queue = *queues[first];
+        std::lock_guard<std::mutex> lockGuard(queue.lock);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            --pendingTasks;
+            return true;
+        }
+    }
+
+    //  steal - from the back of the other queues
+    for (unsigned long i = isWorker ? 1 : 0; i < queues.size(); ++i) {
+        WorkQueue &queue = *queues[(first + i) % queues.size()];
+        std::lock_guard<std::mutex> lockGuard(queue.lock);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            --pendingTasks;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::runPendingTask() {
+    Task task;
+    if (!popTask(task)) return false;
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(unsigned long index) {
+    currentPool = this;
+    currentIndex = index;
+    while (true) {
+        if (runPendingTask()) continue;
+        std::unique_lock<std::mutex> uniqueLock(sleepLock);
+        wakeUp.wait(uniqueLock, [this] { return done || 0 < pendingTasks; });
+        if (done && 0 == pendingTasks) return;
+    }
+}
@@ -0,0 +1,113 @@
+
+#ifndef ENCRYPTEDKMEANS_THREADPOOL_H
+#define ENCRYPTEDKMEANS_THREADPOOL_H
+
+/**
+ * @file ThreadPool.h
+ * */
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ * @brief A bounded work-stealing executor.
+ * A fixed number of workers is started once, and every task is pushed into one of the workers' queues.
+ * A worker pops tasks from the front of its own queue, and when it runs dry it steals from the back of the others.
+ * @param numOfThreads number of workers (at least 1).
+ * @note Tasks submitted from inside a worker go to that worker's own queue,
+ *  and waiting on a future (via \fn wait) runs pending tasks instead of blocking,
+ *  so tasks can safely submit and wait on sub-tasks.
+ * */
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned long numOfThreads = std::thread::hardware_concurrency());
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned long size() const {
+        return workers.size();
+    }
+
+    /**
+     * @brief Submit a task to the pool.
+     * @param func a callable (a member function pointer is fine, followed by the object).
+     * @param args arguments bound to the callable. pass references with std::ref / std::cref.
+     * @returns a future holding the result of the task.
+     * @return std::future
+     * */
+    template<typename Func, typename... Args>
+    auto submit(Func &&func, Args &&... args)
+    -> std::future<std::invoke_result_t<Func, Args...> > {
+        using Result = std::invoke_result_t<Func, Args...>;
+        auto task = std::make_shared<std::packaged_task<Result()> >(
+                std::bind(std::forward<Func>(func), std::forward<Args>(args)...));
+        std::future<Result> future = task->get_future();
+        push([task]() { (*task)(); });
+        return future;
+    }
+
+    /**
+     * @brief Wait for a task to finish, running other pending tasks in the meantime.
+     * @returns the result of the task (exceptions thrown by the task are rethrown here).
+     * */
+    template<typename T>
+    T wait(std::future<T> &future) {
+        while (std::future_status::ready != future.wait_for(std::chrono::seconds(0)))
+            if (!runPendingTask())
+                future.wait_for(std::chrono::microseconds(100));
+        return future.get();
+    }
+
+    /**
+     * @brief Wait for a list of tasks to finish, running other pending tasks in the meantime.
+     * */
+    template<typename T>
+    void wait(std::vector<std::future<T> > &futures) {
+        for (std::future<T> &future: futures) wait(future);
+    }
+
+    /**
+     * @brief Pop one pending task (own queue first, then steal) and run it on the calling thread.
+     * @returns false if there was nothing to run.
+     * */
+    bool runPendingTask();
+
+private:
+    using Task = std::function<void()>;
+
+    struct WorkQueue {
+        std::deque<Task> tasks;
+        std::mutex lock;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue> > queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<unsigned long> pendingTasks;
+    std::atomic<unsigned long> nextQueue;
+    std::atomic<bool> done;
+    std::mutex sleepLock;
+    std::condition_variable wakeUp;
+
+    void push(Task task);
+
+    bool popTask(Task &task);
+
+    void workerLoop(unsigned long index);
+};
+
+
+#endif //ENCRYPTEDKMEANS_THREADPOOL_H
@@ -4,6 +4,7 @@
 //#include "properties.h"
 #include "src/KeysServer.h"
 #include "src/Point.h"
+#include "src/PointBatch.h"
 #include "src/Client.h"
 
 #include <sstream>      // std::stringstream
@@ -29,10 +30,23 @@ std::string printDuration(
 }
 
 std::vector<long> decryptPoint(const Point &p, const KeysServer &keysServer) {
-    std::vector<long> pPoint(DIM);
-    for (short dim = 0; dim < DIM; ++dim)
-        pPoint[dim] = keysServer.decryptNum(p[dim]);
-    return pPoint;
+    return keysServer.decryptNums(p.cCoordinates);
+}
+
+std::vector<DecryptedPoint> decryptPointBatch(const PointBatch &batch, const KeysServer &keysServer) {
+    std::vector<DecryptedPoint> pPoints(batch.size(), DecryptedPoint(DIM));
+    for (short dim = 0; dim < DIM; ++dim) {
+        std::vector<long> slots = keysServer.decryptNumSlots(batch.cCoordinates[dim]);
+        for (long i = 0; i < batch.size(); ++i) pPoints[i][dim] = slots[i];
+    }
+    return pPoints;
+}
+
+static void printDecryptedPoint(const DecryptedPoint &p) {
+    cout << "(";
+    for (short dim = 0; dim < DIM - 1; ++dim)
+        cout << p[dim] << ",";
+    cout << p[DIM - 1] << "), ";
 }
 
 void printPoint(const Point &p, const KeysServer &keysServer) {
@@ -54,23 +68,29 @@ printPoints(
         const KeysServer &keysServer
 ) {
     cout << "   [ total of " << points.size() << " points ]   ";
-    for (const Point &p:points) printPoint(p, keysServer);
+    for (const DecryptedPoint &p: keysServer.decryptPoints(points)) printDecryptedPoint(p);
+}
+
+void
+printPoints(
+        const std::vector<PointHandle> &points,
+        const KeysServer &keysServer
+) {
+    cout << "   [ total of " << points.size() << " points ]   ";
+    for (const PointHandle &p:points) printPoint(*p, keysServer);
 }
 
 void printNonEmptyPoints(
         const std::vector<Point> &points,
         const KeysServer &keysServer
 ) {
-    long arr[DIM], cnt = 0;
-    for (const Point &p:points) {
+    long cnt = 0;
+    for (const DecryptedPoint &p: keysServer.decryptPoints(points)) {
         long sum = 0;
-        for (short dim = 0; dim < DIM; ++dim) {
-            arr[dim] = keysServer.decryptNum(p[dim]);
-            sum += arr[dim];
-        }
+        for (short dim = 0; dim < DIM; ++dim) sum += p[dim];
         if (sum) {
             ++cnt;
-            printPoint(p, keysServer);
+            printDecryptedPoint(p);
         }
     }
     cout << " \t\t[ total of " << cnt << " points are not empty, out of " << points.size()
@@ -83,9 +103,7 @@ decAndWriteToFile(
         const std::string &filename,
         const KeysServer &keysServer
 ) {
-    std::vector<DecryptedPoint> decPoints;
-    decPoints.reserve(points.size());
-    for (const Point &p : points) decPoints.push_back(decryptPoint(p, keysServer));
+    const std::vector<DecryptedPoint> decPoints = keysServer.decryptPoints(points);
     std::ofstream outputFileStream(filename);
     std::stringstream ss;
     long sum;
@@ -116,13 +134,14 @@ decAndWriteToFile(
 std::vector<Client> generateDataClients(const KeysServer &keysServer) {
     //    std::uniform_real_distribution<double> dist(0, NUMBERS_RANGE);
     std::uniform_int_distribution<long> dist(1, NUMBERS_RANGE);
-    long tempArr[DIM];
     std::vector<Client> clients(NUMBER_OF_CLIENTS, Client(keysServer));
+    ThreadPool threadPool(NUMBER_OF_THREADS);
     for (Client &client:clients) {
-        for (int n = 0; n < NUMBER_OF_POINTS / NUMBER_OF_CLIENTS; ++n) {
-            for (int dim = 0; dim < DIM; ++dim) tempArr[dim] = randomLongInRange(mt);
-            client.encryptPoint(tempArr);
-        }
+        //  the random numbers are drawn here (mt is not thread-safe), and only the encryption is parallel
+        std::vector<DecryptedPoint> coordinates(NUMBER_OF_POINTS / NUMBER_OF_CLIENTS, DecryptedPoint(DIM));
+        for (DecryptedPoint &pPoint: coordinates)
+            for (long &coor: pPoint) coor = randomLongInRange(mt);
+        client.encryptPoints(coordinates, threadPool);
     }
     /*
     //  another option
@@ -153,7 +172,14 @@ Slice &Slice::addPoint(
         const Ctxt &isIncluded) {
     points.push_back(point);
     counter.push_back(isIncluded);
-    pointTuples.emplace_back(point, isIncluded);
+    return *this;
+}
+
+Slice &Slice::addPoint(
+        Point &&point,
+        Ctxt &&isIncluded) {
+    points.push_back(std::move(point));
+    counter.push_back(std::move(isIncluded));
     return *this;
 }
 
@@ -12,6 +12,7 @@
 #include <helib/intraSlot.h>
 
 #include <vector>
+#include <memory>
 #include <helib/zzX.h>
 #include <helib/Context.h>
 #include <helib/keys.h>
@@ -38,6 +39,11 @@ class KeysServer;
 
 class Point;
 
+//  a shared, read-only reference to a point - copying it does not copy the point's ciphertexts
+using PointHandle = std::shared_ptr<const Point>;
+
+class PointBatch;
+
 class Client;
 
 //  print both the value and it's name. comfy for dgb  // best. macro. EVA!
@@ -49,8 +55,13 @@ void printPoint(const Point &p, const KeysServer &keysServer);
 
 std::vector<long> decryptPoint(const Point &p, const KeysServer &keysServer);
 
+/** @returns the decrypted points packed in the batch, one per occupied slot **/
+std::vector<DecryptedPoint> decryptPointBatch(const PointBatch &batch, const KeysServer &keysServer);
+
 void printPoints(const std::vector<Point> &points, const KeysServer &keysServer);
 
+void printPoints(const std::vector<PointHandle> &points, const KeysServer &keysServer);
+
 void printNonEmptyPoints(const std::vector<Point> &points, const KeysServer &keysServer);
 
 /** Writing points to a specified.
@@ -87,42 +98,38 @@ using PointTuple = std::pair<Point, CBit>;
  * and aux struct to put some order in the
  * */
 struct Slice {
-    std::vector<Point> reps;
+    //  the reps are shared by all the slices split by them, and by the random points they come from
+    std::vector<PointHandle> reps;
     std::vector<Point> points;
-    std::vector<helib::Ctxt> counter;
-    std::vector<PointTuple> pointTuples;
+    std::vector<helib::Ctxt> counter;   //  counter[i] is the isIncluded bit of points[i]
 
     Slice() {
         //        cout << "init cell" << endl;
         reps.reserve(DIM); //   should be one rep per dimension
         points.reserve(NUMBER_OF_POINTS); //   should be one rep per dimension
         counter.reserve(NUMBER_OF_POINTS); //   should be one rep per dimension
-        pointTuples.reserve(NUMBER_OF_POINTS); //   should be one rep per dimension
     }
 
-    Slice &addRep(const Point &point) {
+    Slice &addRep(const PointHandle &point) {
         reps.push_back(point);
         return *this;
     }
 
-    Slice &addReps(const std::vector<Point> &repPoints) {
-        for (const Point &rep:repPoints) reps.push_back(rep);
+    Slice &addReps(const std::vector<PointHandle> &repPoints) {
+        reps.insert(reps.end(), repPoints.begin(), repPoints.end());
         return *this;
     }
 
     Slice &addPoint(const Point &point, const helib::Ctxt &isIncluded);
 
+    Slice &addPoint(Point &&point, helib::Ctxt &&isIncluded);
+
     void printSlice(const KeysServer &keysServer) const;
 
     void clear() {
         reps.clear();
         points.clear();
         counter.clear();
-        pointTuples.clear();
-    }
-
-    ~Slice() {
-        this->clear();
     }
 
 };